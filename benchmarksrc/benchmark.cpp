@@ -1,7 +1,26 @@
 #include <ihashmap.hpp>
 #include <hashmap.hpp>
+#include <groupby.hpp>
+#include <hashjoin.hpp>
+#include <hashcache.hpp>
+#include <expiringtbl.hpp>
+#include <hashmultitbl.hpp>
+#include <interner.hpp>
+#include <strtbl.hpp>
+#include <fixedbytes.hpp>
+#include <keycolumntbl.hpp>
+#include <frozenmap.hpp>
 #include <benchmark/benchmark.h>
 #include <iostream>
+#include <memory>
+#include <list>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <array>
+#include <fstream>
+#include <unordered_set>
 
 template <size_t SZ> struct Garbage
 {
@@ -97,6 +116,1363 @@ template <template <typename, typename> typename Map> struct MapBenchmarks
     }
 };
 
+/**
+ * Clustered ids, like the ones handed out by a bunch of sequences: runs of
+ * `CLUSTER_LEN` consecutive keys starting at random bases.
+ */
+std::vector<size_t> clustered_keys(size_t n)
+{
+    size_t const CLUSTER_LEN = 64;
+    std::vector<size_t> keys;
+    keys.reserve(n);
+    std::mt19937_64 gen(42);
+    std::uniform_int_distribution<size_t> dis(0, std::numeric_limits<uint32_t>::max());
+    while (keys.size() < n) {
+        size_t base = dis(gen);
+        for (size_t i = 0; i < CLUSTER_LEN && keys.size() < n; ++i) {
+            keys.push_back(base + i);
+        }
+    }
+    return keys;
+}
+
+template <typename Probe> struct ProbeBenchmarks
+{
+    using Map = HashTbl<size_t, size_t, Probe>;
+
+    static void BM_lookup_clustered(benchmark::State &state)
+    {
+        size_t nr_keys = state.range(0);
+        std::vector<size_t> keys = clustered_keys(nr_keys);
+        Map map;
+        for (size_t k : keys) {
+            map.insert(k, k);
+        }
+        for (auto _ : state) {
+            for (size_t k : keys) {
+                benchmark::DoNotOptimize(map.get(k));
+            }
+        }
+        size_t total_probe_length = 0;
+        for (size_t k : keys) {
+            total_probe_length += map.probe_length(k);
+        }
+        state.counters["probe_len"] = (double)total_probe_length / (double)nr_keys;
+    }
+
+    static void BM_lookup_clustered_misses(benchmark::State &state)
+    {
+        size_t nr_keys = state.range(0);
+        std::vector<size_t> keys = clustered_keys(nr_keys * 2);
+        Map map;
+        for (size_t i = 0; i < nr_keys; ++i) {
+            map.insert(keys[i], keys[i]);
+        }
+        for (auto _ : state) {
+            for (size_t i = nr_keys; i < keys.size(); ++i) {
+                benchmark::DoNotOptimize(map.get(keys[i]));
+            }
+        }
+        size_t total_probe_length = 0;
+        for (size_t i = nr_keys; i < keys.size(); ++i) {
+            total_probe_length += map.probe_length(keys[i]);
+        }
+        state.counters["probe_len"] = (double)total_probe_length / (double)nr_keys;
+    }
+};
+
+/**
+ * Fill a table with `range(0)` keys, then churn `range(1)`% of them (remove
+ * and replace with fresh keys) a few times over, so the table has the history
+ * that used to leave tombstones everywhere. Then look up keys that were never
+ * inserted.
+ */
+static void BM_lookup_misses_after_churn(benchmark::State &state)
+{
+    size_t nr_keys = state.range(0);
+    size_t churn_pct = state.range(1);
+    HashTbl<size_t, size_t> map;
+    std::vector<size_t> live;
+    live.reserve(nr_keys);
+    std::mt19937_64 gen(42);
+    for (size_t i = 0; i < nr_keys; ++i) {
+        live.push_back(gen() | 1);
+        map.insert(live.back(), i);
+    }
+    for (size_t round = 0; round < 4; ++round) {
+        for (size_t i = 0; i < nr_keys * churn_pct / 100; ++i) {
+            size_t &k = live[gen() % nr_keys];
+            map.remove(k);
+            k = gen() | 1;
+            map.insert(k, i);
+        }
+    }
+    // All our keys are odd, so these are all misses
+    std::vector<size_t> misses;
+    misses.reserve(nr_keys);
+    for (size_t i = 0; i < nr_keys; ++i) {
+        misses.push_back(gen() & ~(size_t)1);
+    }
+    for (auto _ : state) {
+        for (size_t k : misses) {
+            benchmark::DoNotOptimize(map.get(k));
+        }
+    }
+    size_t total_probe_length = 0;
+    for (size_t k : misses) {
+        total_probe_length += map.probe_length(k);
+    }
+    state.counters["probe_len"] = (double)total_probe_length / (double)nr_keys;
+}
+
+template <typename SlotLayout> struct LayoutBenchmarks
+{
+    using Map = HashTbl<size_t, size_t, LinearProbe, SlotLayout>;
+
+    /**
+     * Insert `range(0)` random keys, then look up `range(0)` random keys of
+     * which `range(1)`% are hits, in an order unrelated to insertion.
+     */
+    static void BM_lookup_randoms(benchmark::State &state)
+    {
+        size_t nr_keys = state.range(0);
+        size_t hit_pct = state.range(1);
+        std::mt19937_64 gen(42);
+        std::vector<size_t> keys;
+        keys.reserve(nr_keys);
+        Map map;
+        for (size_t i = 0; i < nr_keys; ++i) {
+            keys.push_back(gen());
+            map.insert(keys.back(), i);
+        }
+        std::vector<size_t> lookups;
+        lookups.reserve(nr_keys);
+        for (size_t i = 0; i < nr_keys; ++i) {
+            lookups.push_back(gen() % 100 < hit_pct ? keys[gen() % nr_keys] : gen());
+        }
+        for (auto _ : state) {
+            for (size_t k : lookups) {
+                benchmark::DoNotOptimize(map.get(k));
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * nr_keys);
+    }
+};
+
+/**
+ * Fill a table with 1M keys, remove all but `range(0)`% of them, then time a
+ * full scan.
+ */
+static void BM_iter_sparse(benchmark::State &state)
+{
+    size_t const nr_keys = 1 << 20;
+    size_t occupancy_pct = state.range(0);
+    HashTbl<size_t, size_t> map;
+    std::mt19937_64 gen(42);
+    std::vector<size_t> keys;
+    keys.reserve(nr_keys);
+    for (size_t i = 0; i < nr_keys; ++i) {
+        keys.push_back(gen());
+        map.insert(keys.back(), i);
+    }
+    for (size_t k : keys) {
+        if (gen() % 100 >= occupancy_pct) map.remove(k);
+    }
+    for (auto _ : state) {
+        size_t sum = 0;
+        for (auto kv : map) {
+            sum += kv.second;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * map.size());
+}
+
+/**
+ * Purge the odd values out of a table of `range(0)` random keys, either with
+ * `erase_if()` or by collecting the keys and `remove()`-ing them one by one.
+ */
+template <bool USE_ERASE_IF> static void BM_purge(benchmark::State &state)
+{
+    size_t nr_keys = state.range(0);
+    std::unique_ptr<HashTbl<size_t, size_t>> map;
+    for (auto _ : state) {
+        state.PauseTiming();
+        map.reset(new HashTbl<size_t, size_t>());
+        std::mt19937_64 gen(42);
+        for (size_t i = 0; i < nr_keys; ++i) {
+            map->insert(gen(), i);
+        }
+        state.ResumeTiming();
+        if (USE_ERASE_IF) {
+            benchmark::DoNotOptimize(
+                map->erase_if([](size_t const &, size_t &v) { return v % 2 == 1; }));
+        } else {
+            std::vector<size_t> doomed;
+            for (auto kv : *map) {
+                if (kv.second % 2 == 1) doomed.push_back(kv.first);
+            }
+            for (size_t k : doomed) {
+                map->remove(k);
+            }
+        }
+    }
+}
+
+template <typename K> K make_key(size_t n);
+
+template <> size_t make_key<size_t>(size_t n)
+{
+    return n;
+}
+
+template <> std::string make_key<std::string>(size_t n)
+{
+    return "some/longish/metric/name/" + std::to_string(n);
+}
+
+/**
+ * Move `range(0)` entries from a hot table into a cold one, either through
+ * node handles or with get + copy + remove + insert.
+ */
+template <typename K, bool USE_NODES> static void BM_migrate(benchmark::State &state)
+{
+    size_t nr_keys = state.range(0);
+    std::vector<K> keys;
+    keys.reserve(nr_keys);
+    std::mt19937_64 gen(42);
+    for (size_t i = 0; i < nr_keys; ++i) {
+        keys.push_back(make_key<K>(gen()));
+    }
+    std::unique_ptr<HashTbl<K, size_t>> hot, cold;
+    for (auto _ : state) {
+        state.PauseTiming();
+        hot.reset(new HashTbl<K, size_t>());
+        cold.reset(new HashTbl<K, size_t>());
+        for (size_t i = 0; i < nr_keys; ++i) {
+            hot->insert(keys[i], i);
+        }
+        state.ResumeTiming();
+        for (K const &k : keys) {
+            if (USE_NODES) {
+                cold->insert(hot->extract(k));
+            } else {
+                size_t *v = hot->get(k);
+                if (!v) continue;
+                K key = k;
+                size_t val = *v;
+                hot->remove(k);
+                cold->insert(std::move(key), val);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * nr_keys);
+}
+
+/**
+ * Merge 16 per-thread partial tables (with overlapping keys, whose values get
+ * summed) into one, either with `merge()` or by iterating and `insert()`-ing.
+ */
+template <bool USE_MERGE> static void BM_merge_partials(benchmark::State &state)
+{
+    size_t const NR_PARTIALS = 16;
+    size_t nr_keys = state.range(0);
+    std::mt19937_64 gen(42);
+    std::uniform_int_distribution<size_t> dis(0, nr_keys);
+    std::vector<size_t> keys;
+    keys.reserve(nr_keys);
+    for (size_t i = 0; i < nr_keys; ++i) {
+        keys.push_back(dis(gen));
+    }
+    std::vector<std::unique_ptr<HashTbl<size_t, size_t>>> partials(NR_PARTIALS);
+    std::unique_ptr<HashTbl<size_t, size_t>> merged;
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (size_t p = 0; p < NR_PARTIALS; ++p) {
+            partials[p].reset(new HashTbl<size_t, size_t>());
+            for (size_t i = p; i < nr_keys; i += NR_PARTIALS) {
+                size_t *v = partials[p]->get(keys[i]);
+                if (v) {
+                    ++*v;
+                } else {
+                    partials[p]->insert(keys[i], 1);
+                }
+            }
+        }
+        merged.reset(new HashTbl<size_t, size_t>());
+        state.ResumeTiming();
+        for (size_t p = 0; p < NR_PARTIALS; ++p) {
+            if (USE_MERGE) {
+                merged->merge(std::move(*partials[p]), [](size_t &v, size_t &&other) { v += other; });
+            } else {
+                for (auto kv : *partials[p]) {
+                    size_t *v = merged->get(kv.first);
+                    if (v) {
+                        *v += kv.second;
+                    } else {
+                        merged->insert(kv.first, kv.second);
+                    }
+                }
+            }
+        }
+        benchmark::DoNotOptimize(merged->size());
+    }
+    state.SetItemsProcessed(state.iterations() * nr_keys);
+}
+
+enum class AggImpl
+{
+    UNORDERED_MAP,
+    GET_THEN_INSERT,
+    GROUPBY,
+};
+
+/**
+ * Sum `range(0)` rows into `range(1)` groups. The rows are generated as a
+ * handful of chunks that we cycle through, since 100M rows of keys and values
+ * don't need to all sit in memory at once to stress the table.
+ */
+template <AggImpl IMPL> static void BM_groupby_sum(benchmark::State &state)
+{
+    size_t const CHUNK_LEN = 1 << 20;
+    size_t const NR_CHUNKS = 8;
+    size_t nr_rows = state.range(0);
+    size_t nr_groups = state.range(1);
+    std::mt19937_64 gen(42);
+    std::vector<size_t> group_keys;
+    for (size_t i = 0; i < nr_groups; ++i) {
+        group_keys.push_back(gen());
+    }
+    std::uniform_int_distribution<size_t> dis(0, nr_groups - 1);
+    std::vector<std::vector<size_t>> keys(NR_CHUNKS);
+    std::vector<std::vector<size_t>> vals(NR_CHUNKS);
+    for (size_t c = 0; c < NR_CHUNKS; ++c) {
+        for (size_t i = 0; i < CHUNK_LEN; ++i) {
+            keys[c].push_back(group_keys[dis(gen)]);
+            vals[c].push_back(gen() & 0xffff);
+        }
+    }
+
+    for (auto _ : state) {
+        std::unordered_map<size_t, size_t> umap;
+        HashTbl<size_t, size_t> tbl;
+        GroupBy<size_t, size_t> groupby;
+        for (size_t row = 0; row < nr_rows; row += CHUNK_LEN) {
+            size_t const *ks = keys[row / CHUNK_LEN % NR_CHUNKS].data();
+            size_t const *vs = vals[row / CHUNK_LEN % NR_CHUNKS].data();
+            size_t n = std::min(CHUNK_LEN, nr_rows - row);
+            switch (IMPL) {
+            case AggImpl::UNORDERED_MAP:
+                for (size_t i = 0; i < n; ++i) {
+                    umap[ks[i]] += vs[i];
+                }
+                break;
+            case AggImpl::GET_THEN_INSERT:
+                for (size_t i = 0; i < n; ++i) {
+                    size_t *v = tbl.get(ks[i]);
+                    if (v) {
+                        *v += vs[i];
+                    } else {
+                        tbl.insert(ks[i], vs[i]);
+                    }
+                }
+                break;
+            case AggImpl::GROUPBY:
+                groupby.ingest(ks, vs, n);
+                break;
+            }
+        }
+        benchmark::DoNotOptimize(umap.size() + tbl.size() + groupby.size());
+    }
+    state.SetItemsProcessed(state.iterations() * nr_rows);
+}
+
+/**
+ * Join `range(0)` build rows (every key twice) with 16M probe rows, `range(1)`
+ * percent of which have a match.
+ */
+template <bool PARTITIONED> static void BM_hash_join(benchmark::State &state)
+{
+    size_t const NR_PROBE = 1 << 24;
+    size_t nr_build = state.range(0);
+    size_t selectivity = state.range(1);
+    // An odd multiplier is a bijection, so these are distinct but look random
+    auto key_of = [](uint64_t idx) { return idx * 0xbf58476d1ce4e5b9; };
+    std::vector<uint64_t> build_keys, probe_keys;
+    std::vector<uint32_t> build_rows, probe_rows;
+    build_keys.reserve(nr_build);
+    build_rows.reserve(nr_build);
+    for (size_t i = 0; i < nr_build; ++i) {
+        build_keys.push_back(key_of(i % (nr_build / 2)));
+        build_rows.push_back(i);
+    }
+    std::mt19937_64 gen(42);
+    std::uniform_int_distribution<uint64_t> dis(0, nr_build / 2 - 1);
+    std::uniform_int_distribution<size_t> percent(0, 99);
+    probe_keys.reserve(NR_PROBE);
+    probe_rows.reserve(NR_PROBE);
+    for (size_t i = 0; i < NR_PROBE; ++i) {
+        bool hit = percent(gen) < selectivity;
+        probe_keys.push_back(key_of(dis(gen) + (hit ? 0 : nr_build)));
+        probe_rows.push_back(i);
+    }
+
+    size_t nr_matches = 0;
+    for (auto _ : state) {
+        HashJoin<uint64_t, uint32_t> join(PARTITIONED ? HashJoin<uint64_t, uint32_t>::AUTO_RADIX_BITS
+                                                      : 0);
+        join.build(build_keys.data(), build_rows.data(), nr_build);
+        uint64_t checksum = 0;
+        nr_matches = join.probe(probe_keys.data(), probe_rows.data(), NR_PROBE,
+                                [&checksum](uint32_t b, uint32_t p) { checksum += b ^ p; });
+        benchmark::DoNotOptimize(checksum);
+    }
+    state.counters["matches"] = nr_matches;
+    state.SetItemsProcessed(state.iterations() * (nr_build + NR_PROBE));
+}
+
+/**
+ * `n` accesses to a universe of `nr_keys` keys, where the key of rank `i` is
+ * accessed with probability proportional to `1 / i^s`.
+ */
+std::vector<size_t> zipf_trace(size_t n, size_t nr_keys, double s)
+{
+    std::vector<double> cdf(nr_keys);
+    double total = 0;
+    for (size_t i = 0; i < nr_keys; ++i) {
+        total += 1 / std::pow((double)(i + 1), s);
+        cdf[i] = total;
+    }
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> dis(0, total);
+    std::vector<size_t> trace;
+    trace.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        size_t rank = std::upper_bound(cdf.begin(), cdf.end(), dis(gen)) - cdf.begin();
+        // Scatter the ranks so that hot keys aren't neighbours
+        trace.push_back(std::min(rank, nr_keys - 1) * 0xbf58476d1ce4e5b9);
+    }
+    return trace;
+}
+
+/**
+ * The usual LRU cache: a list in recency order, and a map to find list nodes.
+ */
+struct ListLru
+{
+    typedef std::list<std::pair<size_t, size_t>> list_t;
+
+    size_t capacity;
+    list_t entries;
+    std::unordered_map<size_t, list_t::iterator> index;
+
+    ListLru(size_t capacity)
+        : capacity(capacity)
+    {
+    }
+
+    size_t *get(size_t key)
+    {
+        auto it = index.find(key);
+        if (it == index.end()) return nullptr;
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->second;
+    }
+
+    void put(size_t key, size_t val)
+    {
+        if (size_t *v = get(key)) {
+            *v = val;
+            return;
+        }
+        if (entries.size() >= capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+        entries.emplace_front(key, val);
+        index[key] = entries.begin();
+    }
+};
+
+/**
+ * Replay a Zipfian trace over 1M keys (get, and put on a miss) through a cache
+ * holding `range(0)` per mille of them.
+ */
+template <bool USE_CLOCK> static void BM_cache_zipf(benchmark::State &state)
+{
+    size_t const NR_KEYS = 1 << 20;
+    static std::vector<size_t> const trace = zipf_trace(1 << 22, NR_KEYS, 0.99);
+    // Size the LRU to however many entries the CLOCK cache ends up holding
+    size_t budget = NR_KEYS * state.range(0) / 1000 * (sizeof(HashTbl<size_t, size_t>::Entry) + 1);
+    size_t nr_hits = 0;
+    for (auto _ : state) {
+        HashCache<size_t, size_t> clock(budget);
+        ListLru lru(clock.capacity());
+        nr_hits = 0;
+        for (size_t key : trace) {
+            size_t *v = USE_CLOCK ? clock.get(key) : lru.get(key);
+            if (v) {
+                nr_hits++;
+                benchmark::DoNotOptimize(*v);
+            } else if (USE_CLOCK) {
+                clock.put(key, key);
+            } else {
+                lru.put(key, key);
+            }
+        }
+    }
+    state.counters["hit_rate"] = (double)nr_hits / trace.size();
+    state.SetItemsProcessed(state.iterations() * trace.size());
+}
+
+/**
+ * A steady expiry rate: every tick inserts 1000 keys that live for 1000 ticks
+ * (so about 1M are live), looks up 1000 keys inserted over the last 1.5 TTLs
+ * (so some have expired), and reclaims expired entries. With `range(0)` ctrl
+ * chunks, `sweep()` reclaims a little every tick; with 0, a full sweep every
+ * 100 ticks does the same work in bursts.
+ */
+static void BM_expiry_steady(benchmark::State &state)
+{
+    size_t const TTL = 1000;
+    size_t const NR_PER_TICK = 1000;
+    size_t const FULL_SWEEP_INTERVAL = 100;
+    size_t budget = state.range(0);
+
+    ExpiringTbl<size_t, size_t> tbl;
+    std::mt19937_64 gen(7);
+    uint32_t now = 0;
+    size_t next_key = 0;
+    auto sweep = [&]() {
+        if (budget) return tbl.sweep(now, budget);
+        if (now % FULL_SWEEP_INTERVAL == 0) return tbl.sweep(now, tbl.nr_ctrlchunks());
+        return (size_t)0;
+    };
+    auto tick = [&]() {
+        for (size_t i = 0; i < NR_PER_TICK; ++i, ++next_key) {
+            tbl.insert(next_key * 0x9e3779b97f4a7c15, next_key, now + TTL);
+        }
+        size_t nr_hits = 0;
+        size_t window = std::min(next_key, TTL * NR_PER_TICK * 3 / 2);
+        for (size_t i = 0; i < NR_PER_TICK; ++i) {
+            size_t k = next_key - 1 - gen() % window;
+            nr_hits += tbl.get(k * 0x9e3779b97f4a7c15, now) != nullptr;
+        }
+        return nr_hits;
+    };
+    // Get to the steady state first
+    for (; now < 2 * TTL; ++now) {
+        tick();
+        sweep();
+    }
+
+    double lookup_ns = 0, sweep_ns = 0, max_sweep_ns = 0;
+    size_t nr_hits = 0, nr_reclaimed = 0;
+    for (auto _ : state) {
+        auto t0 = std::chrono::steady_clock::now();
+        nr_hits += tick();
+        auto t1 = std::chrono::steady_clock::now();
+        nr_reclaimed += sweep();
+        auto t2 = std::chrono::steady_clock::now();
+        now++;
+        lookup_ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+        double ns = std::chrono::duration<double, std::nano>(t2 - t1).count();
+        sweep_ns += ns;
+        max_sweep_ns = std::max(max_sweep_ns, ns);
+    }
+    size_t nr_ticks = state.iterations();
+    state.counters["insert_lookup_ns"] = lookup_ns / (nr_ticks * NR_PER_TICK * 2);
+    state.counters["sweep_ns_per_tick"] = sweep_ns / nr_ticks;
+    state.counters["max_sweep_us"] = max_sweep_ns / 1000;
+    state.counters["hit_rate"] = (double)nr_hits / (nr_ticks * NR_PER_TICK);
+    state.counters["reclaimed_per_tick"] = (double)nr_reclaimed / nr_ticks;
+    state.counters["live"] = tbl.size();
+}
+
+enum class MultiImpl
+{
+    UNORDERED_MULTIMAP,
+    VECTOR_VALS,
+    MULTITBL,
+};
+
+/**
+ * An index over `range(0)` rows with about `range(1)` rows per key, behind a
+ * common interface so that the multimap benchmarks can share their setup.
+ */
+template <MultiImpl IMPL> struct MultiIndex;
+
+template <> struct MultiIndex<MultiImpl::UNORDERED_MULTIMAP>
+{
+    std::unordered_multimap<size_t, size_t> map;
+
+    void build(std::vector<size_t> const &keys, std::vector<size_t> const &vals)
+    {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            map.emplace(keys[i], vals[i]);
+        }
+    }
+
+    size_t sum(size_t key)
+    {
+        size_t total = 0;
+        auto range = map.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it) {
+            total += it->second;
+        }
+        return total;
+    }
+};
+
+template <> struct MultiIndex<MultiImpl::VECTOR_VALS>
+{
+    HashTbl<size_t, std::vector<size_t>> tbl;
+
+    void build(std::vector<size_t> const &keys, std::vector<size_t> const &vals)
+    {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            size_t v = vals[i];
+            tbl.upsert(keys[i], std::vector<size_t>(1, v),
+                       [v](std::vector<size_t> &vs) { vs.push_back(v); });
+        }
+    }
+
+    size_t sum(size_t key)
+    {
+        size_t total = 0;
+        if (std::vector<size_t> *vs = tbl.get(key)) {
+            for (size_t v : *vs) {
+                total += v;
+            }
+        }
+        return total;
+    }
+};
+
+template <> struct MultiIndex<MultiImpl::MULTITBL>
+{
+    HashMultiTbl<size_t, size_t> tbl;
+
+    void build(std::vector<size_t> const &keys, std::vector<size_t> const &vals)
+    {
+        size_t const BATCH = 1 << 16;
+        for (size_t start = 0; start < keys.size(); start += BATCH) {
+            size_t n = std::min(BATCH, keys.size() - start);
+            tbl.insert_batch(&keys[start], &vals[start], n);
+        }
+    }
+
+    size_t sum(size_t key)
+    {
+        size_t total = 0;
+        auto range = tbl.equal_range(key);
+        for (size_t *v = range.first; v != range.second; ++v) {
+            total += *v;
+        }
+        return total;
+    }
+};
+
+std::vector<size_t> multimap_keys(size_t nr_rows, size_t fanout)
+{
+    std::mt19937_64 gen(13);
+    std::uniform_int_distribution<size_t> dis(0, nr_rows / fanout - 1);
+    std::vector<size_t> keys;
+    keys.reserve(nr_rows);
+    for (size_t i = 0; i < nr_rows; ++i) {
+        keys.push_back(dis(gen) * 0x9e3779b97f4a7c15);
+    }
+    return keys;
+}
+
+template <MultiImpl IMPL> static void BM_multimap_build(benchmark::State &state)
+{
+    std::vector<size_t> keys = multimap_keys(state.range(0), state.range(1));
+    std::vector<size_t> vals(keys.size());
+    std::iota(vals.begin(), vals.end(), 0);
+    for (auto _ : state) {
+        MultiIndex<IMPL> index;
+        index.build(keys, vals);
+        benchmark::DoNotOptimize(index);
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+/**
+ * Sum every value of each of the keys in random order.
+ */
+template <MultiImpl IMPL> static void BM_multimap_scan(benchmark::State &state)
+{
+    std::vector<size_t> keys = multimap_keys(state.range(0), state.range(1));
+    std::vector<size_t> vals(keys.size());
+    std::iota(vals.begin(), vals.end(), 0);
+    MultiIndex<IMPL> index;
+    index.build(keys, vals);
+    std::vector<size_t> lookups(keys.begin(), keys.begin() + keys.size() / state.range(1));
+    for (auto _ : state) {
+        size_t total = 0;
+        for (size_t key : lookups) {
+            total += index.sum(key);
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * lookups.size());
+}
+
+/**
+ * Hostname-like strings, `range(1)` distinct ones repeated to make up
+ * `range(0)`.
+ */
+std::vector<std::string> intern_trace(size_t n, size_t nr_distinct)
+{
+    std::mt19937_64 gen(19);
+    std::uniform_int_distribution<size_t> dis(0, nr_distinct - 1);
+    std::vector<std::string> trace;
+    trace.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        size_t k = dis(gen);
+        trace.push_back("host-" + std::to_string(k) + ".dc" + std::to_string(k % 7) +
+                        ".example.com");
+    }
+    return trace;
+}
+
+/**
+ * Intern a log's worth of strings, either with a `StringInterner` or with the
+ * usual `HashTbl<std::string, uint32_t>` plus a `std::vector<std::string>`.
+ */
+template <bool USE_INTERNER> static void BM_intern(benchmark::State &state)
+{
+    std::vector<std::string> trace = intern_trace(state.range(0), state.range(1));
+    size_t memory = 0;
+    for (auto _ : state) {
+        if (USE_INTERNER) {
+            StringInterner interner;
+            for (std::string const &str : trace) {
+                benchmark::DoNotOptimize(interner.intern(str));
+            }
+            memory = interner.memory_usage();
+        } else {
+            HashTbl<std::string, uint32_t> ids;
+            std::vector<std::string> strs;
+            for (std::string const &str : trace) {
+                uint32_t *id = ids.get(str);
+                if (!id) {
+                    id = ids.insert(str, strs.size());
+                    strs.push_back(str);
+                }
+                benchmark::DoNotOptimize(*id);
+            }
+            // Every string is held twice, and anything past the SSO buffer is
+            // its own allocation (with at least 16 bytes of malloc overhead)
+            memory = ids.nr_ctrlchunks() * CtrlChunk::NR_BYTES *
+                         (sizeof(HashTbl<std::string, uint32_t>::Entry) + 1) +
+                     strs.capacity() * sizeof(std::string);
+            for (std::string const &str : strs) {
+                if (str.capacity() > 15) memory += 2 * alignup(str.capacity() + 1 + 8, 16);
+            }
+        }
+    }
+    state.counters["MB"] = memory / 1e6;
+    state.SetItemsProcessed(state.iterations() * trace.size());
+}
+
+/**
+ * `n` distinct random keys of exactly `len` bytes.
+ */
+std::vector<std::string> fixed_len_keys(size_t n, size_t len)
+{
+    std::mt19937_64 gen(29);
+    std::uniform_int_distribution<int> dis('a', 'z');
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        // Number them so that they're distinct
+        std::string key = std::to_string(i) + ":";
+        while (key.size() < len) {
+            key.push_back(dis(gen));
+        }
+        keys.push_back(key);
+    }
+    return keys;
+}
+
+template <bool USE_ARENA> struct StringKeyTbl;
+
+template <> struct StringKeyTbl<true>
+{
+    StrTbl<size_t> tbl;
+
+    void insert(std::string const &key, size_t val)
+    {
+        tbl.insert(key, val);
+    }
+
+    size_t *get(std::string const &key)
+    {
+        return tbl.get(key);
+    }
+};
+
+template <> struct StringKeyTbl<false>
+{
+    HashTbl<std::string, size_t> tbl;
+
+    void insert(std::string const &key, size_t val)
+    {
+        tbl.insert(key, val);
+    }
+
+    size_t *get(std::string const &key)
+    {
+        return tbl.get(key);
+    }
+};
+
+/**
+ * Insert 1M keys of `range(0)` bytes into a `StrTbl` or a
+ * `HashTbl<std::string, ...>`.
+ */
+template <bool USE_ARENA> static void BM_string_keys_insert(benchmark::State &state)
+{
+    std::vector<std::string> keys = fixed_len_keys(1 << 20, state.range(0));
+    for (auto _ : state) {
+        StringKeyTbl<USE_ARENA> tbl;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            tbl.insert(keys[i], i);
+        }
+        benchmark::DoNotOptimize(tbl);
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+/**
+ * Look up each of 1M keys of `range(0)` bytes, in random order.
+ */
+template <bool USE_ARENA> static void BM_string_keys_lookup(benchmark::State &state)
+{
+    std::vector<std::string> keys = fixed_len_keys(1 << 20, state.range(0));
+    StringKeyTbl<USE_ARENA> tbl;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tbl.insert(keys[i], i);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(31));
+    for (auto _ : state) {
+        size_t total = 0;
+        for (std::string const &key : keys) {
+            total += *tbl.get(key);
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+/** Hashes a `std::array` of bytes, since the standard library won't */
+struct ByteArrayHash
+{
+    template <size_t N> size_t operator()(std::array<uint8_t, N> const &key) const
+    {
+        return hash_bytes((char const *)key.data(), N);
+    }
+};
+
+/**
+ * `n` distinct `N`-byte keys that look like 5-tuples: the same leading bytes
+ * (addresses), and random trailing ones (ports).
+ */
+template <size_t N> std::vector<std::array<uint8_t, N>> binary_keys(size_t n)
+{
+    std::mt19937_64 gen(41);
+    std::vector<std::array<uint8_t, N>> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i].fill(0);
+        keys[i][0] = 10;
+        uint64_t tail = i * 0x9e3779b97f4a7c15 + (gen() & 0xff);
+        memcpy(keys[i].data() + N - sizeof(tail) / 2, &tail, sizeof(tail) / 2);
+    }
+    return keys;
+}
+
+/**
+ * Insert 1M `N`-byte keys, then look each up in random order, with either
+ * `HashTbl<FixedBytes<N>, ...>` or `std::unordered_map<std::array<...>, ...>`.
+ */
+template <size_t N, bool USE_FIXED> static void BM_binary_keys(benchmark::State &state)
+{
+    std::vector<std::array<uint8_t, N>> keys = binary_keys<N>(1 << 20);
+    std::vector<std::array<uint8_t, N>> lookups = keys;
+    std::shuffle(lookups.begin(), lookups.end(), std::mt19937_64(43));
+    for (auto _ : state) {
+        size_t total = 0;
+        if (USE_FIXED) {
+            HashTbl<FixedBytes<N>, size_t> tbl;
+            for (size_t i = 0; i < keys.size(); ++i) {
+                tbl.insert(FixedBytes<N>(keys[i].data()), i);
+            }
+            for (auto const &key : lookups) {
+                total += *tbl.get(FixedBytes<N>(key.data()));
+            }
+        } else {
+            std::unordered_map<std::array<uint8_t, N>, size_t, ByteArrayHash> map;
+            for (size_t i = 0; i < keys.size(); ++i) {
+                map[keys[i]] = i;
+            }
+            for (auto const &key : lookups) {
+                total += map.find(key)->second;
+            }
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size() * 2);
+}
+
+/**
+ * `n` distinct random `uint32_t` keys to insert, and `n` to look up, of which
+ * `hit_percent`% are in the first lot.
+ */
+static void u32_keys(size_t n, size_t hit_percent, std::vector<uint32_t> &keys,
+                     std::vector<uint32_t> &lookups)
+{
+    std::mt19937 gen(47);
+    std::unordered_set<uint32_t> seen;
+    keys.clear();
+    lookups.clear();
+    while (keys.size() < n) {
+        uint32_t key = gen();
+        if (seen.insert(key).second) keys.push_back(key);
+    }
+    while (lookups.size() < n) {
+        if (gen() % 100 < hit_percent) {
+            lookups.push_back(keys[gen() % n]);
+            continue;
+        }
+        uint32_t key = gen();
+        if (!seen.count(key)) lookups.push_back(key);
+    }
+}
+
+/**
+ * Insert `n` random `uint32_t` keys into either a `KeyColumnTbl` or a
+ * `HashTbl`.
+ */
+template <bool USE_KEY_COLUMN> static void BM_u32_keys_insert(benchmark::State &state)
+{
+    std::vector<uint32_t> keys, lookups;
+    u32_keys(state.range(0), 0, keys, lookups);
+    for (auto _ : state) {
+        if (USE_KEY_COLUMN) {
+            KeyColumnTbl<uint32_t, uint32_t> tbl;
+            for (size_t i = 0; i < keys.size(); ++i) {
+                tbl.insert(keys[i], i);
+            }
+            benchmark::DoNotOptimize(tbl.size());
+        } else {
+            HashTbl<uint32_t, uint32_t> tbl;
+            for (size_t i = 0; i < keys.size(); ++i) {
+                tbl.insert(keys[i], i);
+            }
+            benchmark::DoNotOptimize(tbl.size());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+/**
+ * Look up `n` `uint32_t` keys in a table of `n`, `hit_percent`% of which are
+ * there.
+ */
+template <bool USE_KEY_COLUMN> static void BM_u32_keys_lookup(benchmark::State &state)
+{
+    std::vector<uint32_t> keys, lookups;
+    u32_keys(state.range(0), state.range(1), keys, lookups);
+    KeyColumnTbl<uint32_t, uint32_t> key_column_tbl;
+    HashTbl<uint32_t, uint32_t> tbl;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (USE_KEY_COLUMN) {
+            key_column_tbl.insert(keys[i], i);
+        } else {
+            tbl.insert(keys[i], i);
+        }
+    }
+    for (auto _ : state) {
+        size_t total = 0;
+        for (uint32_t key : lookups) {
+            uint32_t *val = USE_KEY_COLUMN ? key_column_tbl.get(key) : tbl.get(key);
+            if (val) total += *val;
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * lookups.size());
+}
+
+/**
+ * `BM_u32_keys_lookup<true>`, but through `get_batch()` with the `LEVEL`
+ * compare, in batches of 1K.
+ */
+template <SimdLevel LEVEL> static void BM_u32_keys_get_batch(benchmark::State &state)
+{
+    if (!simd_level_supported(LEVEL)) {
+        state.SkipWithError("not supported by this CPU");
+        return;
+    }
+    force_simd_level(LEVEL);
+    std::vector<uint32_t> keys, lookups;
+    u32_keys(state.range(0), state.range(1), keys, lookups);
+    KeyColumnTbl<uint32_t, uint32_t> tbl;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tbl.insert(keys[i], i);
+    }
+    size_t const batch_len = 1024;
+    uint32_t *vals[batch_len];
+    for (auto _ : state) {
+        size_t total = 0;
+        for (size_t start = 0; start < lookups.size(); start += batch_len) {
+            size_t n = std::min(batch_len, lookups.size() - start);
+            tbl.get_batch(&lookups[start], n, vals);
+            for (size_t i = 0; i < n; ++i) {
+                if (vals[i]) total += *vals[i];
+            }
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    force_simd_level(detect_simd_level());
+    state.SetItemsProcessed(state.iterations() * lookups.size());
+}
+
+/**
+ * Count 4M random keys of type `Key`, then look each one up again, in a
+ * `DirectTbl` with `DIRECT` and in a hashed `HashTbl` otherwise.
+ */
+template <typename Key, bool DIRECT> static void BM_tiny_keys(benchmark::State &state)
+{
+    typedef typename std::conditional<DIRECT, DirectTbl<Key, size_t>, HashTbl<Key, size_t>>::type tbl_t;
+    std::mt19937_64 gen(53);
+    std::vector<Key> keys(1 << 22);
+    for (Key &key : keys) {
+        key = gen();
+    }
+    for (auto _ : state) {
+        tbl_t counts;
+        for (Key key : keys) {
+            counts.upsert(key, 1, [](size_t &count) { count++; });
+        }
+        size_t total = 0;
+        for (Key key : keys) {
+            total += *counts.get(key);
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size() * 2);
+}
+
+/**
+ * Run the `LEVEL` present scan over 64K ctrl chunks (1MB, so about L2 sized),
+ * half of whose bytes are empty.
+ */
+template <SimdLevel LEVEL> static void BM_scan_ctrlchunks(benchmark::State &state)
+{
+    if (!simd_level_supported(LEVEL)) {
+        state.SkipWithError("not supported by this CPU");
+        return;
+    }
+    SimdKernels const &kernels = simd_kernels_for(LEVEL);
+    size_t const nr_chunks = 1 << 16;
+    std::vector<CtrlChunk> chunks(nr_chunks);
+    std::mt19937_64 gen(59);
+    for (CtrlChunk &chunk : chunks) {
+        for (size_t i = 0; i < CtrlChunk::NR_BYTES; ++i) {
+            chunk.byte_at(i) = gen() % 2 ? CtrlChunk::CTRL_EMPTY : (char)(gen() & 0x7f);
+        }
+    }
+    std::vector<uint16_t> masks(nr_chunks);
+    for (auto _ : state) {
+        kernels.present_chunks(chunks[0].bytes, nr_chunks, masks.data());
+        benchmark::DoNotOptimize(masks.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * nr_chunks * CtrlChunk::NR_BYTES);
+}
+
+/**
+ * Insert 4M keys with the `LEVEL` kernels doing `rebuild()`'s scans, which is
+ * the only place `HashTbl` uses them.
+ */
+template <SimdLevel LEVEL> static void BM_grow_under_level(benchmark::State &state)
+{
+    if (!simd_level_supported(LEVEL)) {
+        state.SkipWithError("not supported by this CPU");
+        return;
+    }
+    force_simd_level(LEVEL);
+    for (auto _ : state) {
+        HashTbl<size_t, size_t> tbl;
+        for (size_t i = 0; i < (1 << 22); ++i) {
+            tbl.insert(i * 0x9e3779b97f4a7c15, i);
+        }
+        benchmark::DoNotOptimize(tbl.size());
+    }
+    force_simd_level(detect_simd_level());
+    state.SetItemsProcessed(state.iterations() * (1 << 22));
+}
+
+/**
+ * Match a tag against 1MB of ctrl bytes, a group at a time, with the SSE2
+ * (`__m128i`, 16 bytes) or SWAR (`uint64_t`, 8 bytes) backend. This is the
+ * per-probe work, so unlike `BM_scan_ctrlchunks` nothing is batched. To
+ * compare whole tables, build the benchmarks with `-DHASHMAP_SWAR` as well.
+ */
+template <typename T> static void BM_group_match(benchmark::State &state)
+{
+    size_t const nr_bytes = 1 << 20;
+    std::vector<uint64_t> words(nr_bytes / sizeof(uint64_t));
+    std::mt19937_64 gen(61);
+    for (uint64_t &word : words) {
+        word = gen() & 0x7f7f7f7f7f7f7f7f;
+    }
+    char const *bytes = (char const *)words.data();
+    for (auto _ : state) {
+        size_t nr_hits = 0;
+        for (size_t i = 0; i < nr_bytes; i += sizeof(T)) {
+            T group;
+            memcpy(&group, bytes + i, sizeof(T));
+            nr_hits += __builtin_popcount(simd<T>::movemask_eq(group, 0x2a));
+        }
+        benchmark::DoNotOptimize(nr_hits);
+    }
+    state.SetBytesProcessed(state.iterations() * nr_bytes);
+}
+
+/**
+ * Look up 1M random keys, half of them present, in a table of `state.range(0)`
+ * keys, one at a time or through `get_batch()`.
+ */
+template <bool BATCH> static void BM_get_batch(benchmark::State &state)
+{
+    std::mt19937_64 gen(59);
+    HashTbl<size_t, size_t> tbl;
+    std::vector<size_t> keys(state.range(0));
+    for (size_t &key : keys) {
+        key = gen();
+        tbl.insert(key, key);
+    }
+    std::vector<size_t> lookups(1 << 20);
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        lookups[i] = i % 2 ? keys[gen() % keys.size()] : gen();
+    }
+    std::vector<size_t *> found(lookups.size());
+    for (auto _ : state) {
+        size_t nr_found = 0;
+        if (BATCH) {
+            nr_found = tbl.get_batch(lookups.data(), lookups.size(), found.data());
+        } else {
+            for (size_t i = 0; i < lookups.size(); ++i) {
+                found[i] = tbl.get(lookups[i]);
+                nr_found += found[i] != nullptr;
+            }
+        }
+        benchmark::DoNotOptimize(nr_found);
+    }
+    state.SetItemsProcessed(state.iterations() * lookups.size());
+}
+
+/**
+ * Bulk load `state.range(0)` random keys into an empty table, one at a time
+ * or through `insert_batch()`.
+ */
+template <bool BATCH> static void BM_insert_batch(benchmark::State &state)
+{
+    std::mt19937_64 gen(61);
+    std::vector<size_t> keys(state.range(0));
+    for (size_t &key : keys) {
+        key = gen();
+    }
+    for (auto _ : state) {
+        HashTbl<size_t, size_t> tbl;
+        if (BATCH) {
+            tbl.insert_batch(keys.data(), keys.data(), keys.size());
+        } else {
+            for (size_t key : keys) {
+                tbl.insert(key, key);
+            }
+        }
+        benchmark::DoNotOptimize(tbl.size());
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+static void BM_hash_batch(benchmark::State &state)
+{
+    std::vector<uint32_t> keys(4096);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::vector<size_t> hashes(keys.size());
+    for (auto _ : state) {
+        hash_batch(keys.data(), keys.size(), hashes.data());
+        benchmark::DoNotOptimize(hashes.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+/**
+ * Insert `state.range(0)` random keys into a table that either `reserve()`s
+ * for all of them first or grows as it goes.
+ */
+template <bool RESERVE> static void BM_reserve(benchmark::State &state)
+{
+    std::mt19937_64 gen(67);
+    std::vector<size_t> keys(state.range(0));
+    for (size_t &key : keys) {
+        key = gen();
+    }
+    for (auto _ : state) {
+        HashTbl<size_t, size_t> tbl;
+        if (RESERVE) tbl.reserve(keys.size());
+        for (size_t key : keys) {
+            tbl.insert(key, key);
+        }
+        benchmark::DoNotOptimize(tbl.size());
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+/** A field of /proc/self/status, in bytes */
+static size_t proc_status_bytes(char const *field)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, strlen(field), field) == 0) {
+            return std::stoull(line.substr(strlen(field) + 1)) * 1024;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Double a table of `state.range(0)` slots that's just short of needing to
+ * grow, with `Growth`'s rebuild. Besides the time, reports the peak RSS
+ * during the rebuild as a multiple of the old table's buffer (the peak is
+ * reset through /proc/self/clear_refs first).
+ */
+template <typename Growth> static void BM_grow_peak_rss(benchmark::State &state)
+{
+    typedef HashTbl<size_t, size_t, LinearProbe, SplitLayout, Growth> tbl_t;
+    size_t capacity = state.range(0);
+    std::mt19937_64 gen(71);
+    std::vector<size_t> keys(capacity / 4 * 3 - 1);
+    for (size_t &key : keys) {
+        key = gen();
+    }
+    double peak_ratio = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        size_t tbl_bytes;
+        {
+            auto tbl = tbl_t::with_capacity(capacity);
+            for (size_t key : keys) {
+                tbl.insert(key, key);
+            }
+            tbl_bytes = tbl.nr_ctrlchunks() * CtrlChunk::NR_BYTES *
+                        (sizeof(typename tbl_t::Entry) + 1);
+            std::ofstream("/proc/self/clear_refs") << "5";
+            size_t rss_before = proc_status_bytes("VmRSS:");
+            state.ResumeTiming();
+            tbl.rebuild(capacity * 2);
+            state.PauseTiming();
+            peak_ratio = 1 + (double)(proc_status_bytes("VmHWM:") - rss_before) / tbl_bytes;
+        }
+        state.ResumeTiming();
+    }
+    state.counters["peak_x_old"] = peak_ratio;
+}
+
+/**
+ * `Garbage` that also owns a heap allocation, so that moving it has to null
+ * out the source and destructing it has to check. Relocatable only if we say
+ * so.
+ */
+template <size_t SZ, bool RELOCATABLE> struct OwningGarbage
+{
+    Garbage<SZ> garbage;
+    std::unique_ptr<size_t> owned;
+
+    OwningGarbage()
+        : owned(new size_t(SZ))
+    {
+        memset(garbage._, 0, SZ);
+    }
+};
+
+template <size_t SZ, bool RELOCATABLE> struct is_trivially_relocatable<OwningGarbage<SZ, RELOCATABLE>>
+{
+    static constexpr bool value = RELOCATABLE;
+};
+
+/**
+ * Rebuild a table of `state.range(0)` slots holding 512-byte values into one
+ * twice the size, relocating its entries with memcpy() or moving and
+ * destructing each one.
+ */
+template <bool RELOCATABLE> static void BM_rebuild_xl_vals(benchmark::State &state)
+{
+    typedef OwningGarbage<512, RELOCATABLE> val_t;
+    typedef HashTbl<size_t, val_t> tbl_t;
+    size_t capacity = state.range(0);
+    std::mt19937_64 gen(73);
+    std::vector<size_t> keys(capacity / 4 * 3 - 1);
+    for (size_t &key : keys) {
+        key = gen();
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        {
+            auto tbl = tbl_t::with_capacity(capacity);
+            for (size_t key : keys) {
+                tbl.insert(key, val_t());
+            }
+            state.ResumeTiming();
+            tbl.rebuild(capacity * 2);
+            state.PauseTiming();
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+static constexpr std::pair<std::string_view, int> HEADER_NAMES[] = {
+    {"accept", 0},        {"accept-encoding", 1}, {"authorization", 2}, {"cache-control", 3},
+    {"connection", 4},    {"content-length", 5},  {"content-type", 6},  {"cookie", 7},
+    {"date", 8},          {"etag", 9},            {"host", 10},         {"if-none-match", 11},
+    {"location", 12},     {"referer", 13},        {"user-agent", 14},   {"x-forwarded-for", 15},
+};
+static constexpr auto FROZEN_HEADER_NAMES = make_frozen_map(HEADER_NAMES);
+
+/**
+ * Look up a mix of known and unknown header names, in the `constexpr`
+ * `FrozenMap` or in a `HashTbl` filled with the same names.
+ */
+template <bool FROZEN> static void BM_static_lookup(benchmark::State &state)
+{
+    HashTbl<std::string_view, int> tbl;
+    for (auto const &kv : HEADER_NAMES) {
+        tbl.insert(kv.first, kv.second);
+    }
+    std::vector<std::string_view> names;
+    for (auto const &kv : HEADER_NAMES) {
+        names.push_back(kv.first);
+        names.push_back("x-unknown");
+    }
+    for (auto _ : state) {
+        int sum = 0;
+        for (std::string_view const &name : names) {
+            int const *v = FROZEN ? FROZEN_HEADER_NAMES.get(name) : tbl.get(name);
+            if (v) sum += *v;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * names.size());
+}
+
 BENCHMARK(MapBenchmarks<default_std_unordered_map_t>::BM_insert_in_order)->Range(8, 8 << 13);
 BENCHMARK(MapBenchmarks<default_std_unordered_map_t>::BM_insert_randoms)->Range(8, 8 << 13);
 BENCHMARK(MapBenchmarks<default_std_unordered_map_t>::BM_insert_2update_randoms)->Range(8, 8 << 13);
@@ -112,5 +1488,143 @@ BENCHMARK(MapBenchmarks<Table>::BM_insert_randoms)->Range(8, 8 << 13);
 BENCHMARK(MapBenchmarks<Table>::BM_insert_2update_randoms)->Range(8, 8 << 13);
 // BENCHMARK(MapBenchmarks<Table>::BM_insert_in_order_xl_vals)->Range(8, 8 << 13);
 // BENCHMARK(MapBenchmarks<Table>::BM_insert_randoms_xl_vals)->Range(8, 8 << 13);
+BENCHMARK(ProbeBenchmarks<LinearProbe>::BM_lookup_clustered)->Range(8 << 7, 8 << 17);
+BENCHMARK(ProbeBenchmarks<TriangularProbe>::BM_lookup_clustered)->Range(8 << 7, 8 << 17);
+BENCHMARK(ProbeBenchmarks<DoubleHashProbe>::BM_lookup_clustered)->Range(8 << 7, 8 << 17);
+BENCHMARK(ProbeBenchmarks<LinearProbe>::BM_lookup_clustered_misses)->Range(8 << 7, 8 << 17);
+BENCHMARK(ProbeBenchmarks<TriangularProbe>::BM_lookup_clustered_misses)->Range(8 << 7, 8 << 17);
+BENCHMARK(ProbeBenchmarks<DoubleHashProbe>::BM_lookup_clustered_misses)->Range(8 << 7, 8 << 17);
+BENCHMARK(BM_lookup_misses_after_churn)
+    ->Args({1 << 16, 0})
+    ->Args({1 << 16, 25})
+    ->Args({1 << 16, 50})
+    ->Args({1 << 16, 100})
+    ->Args({1 << 20, 0})
+    ->Args({1 << 20, 25})
+    ->Args({1 << 20, 50})
+    ->Args({1 << 20, 100});
+// The biggest of these (16M slots of 24 bytes) is well past the LLC
+BENCHMARK(LayoutBenchmarks<SplitLayout>::BM_lookup_randoms)
+    ->ArgsProduct({{1 << 16, 1 << 20, 1 << 23}, {0, 100}});
+BENCHMARK(LayoutBenchmarks<InterleavedLayout>::BM_lookup_randoms)
+    ->ArgsProduct({{1 << 16, 1 << 20, 1 << 23}, {0, 100}});
+BENCHMARK(BM_iter_sparse)->Arg(1)->Arg(10)->Arg(50)->Arg(100);
+BENCHMARK_TEMPLATE(BM_purge, true)->Range(1 << 10, 1 << 22);
+BENCHMARK_TEMPLATE(BM_purge, false)->Range(1 << 10, 1 << 22);
+BENCHMARK_TEMPLATE(BM_migrate, size_t, true)->Arg(1 << 20)->Arg(10000000);
+BENCHMARK_TEMPLATE(BM_migrate, size_t, false)->Arg(1 << 20)->Arg(10000000);
+BENCHMARK_TEMPLATE(BM_migrate, std::string, true)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_migrate, std::string, false)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_merge_partials, true)->Range(1 << 16, 1 << 24);
+BENCHMARK_TEMPLATE(BM_merge_partials, false)->Range(1 << 16, 1 << 24);
+BENCHMARK_TEMPLATE(BM_groupby_sum, AggImpl::UNORDERED_MAP)
+    ->Args({100000000, 1000000})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_groupby_sum, AggImpl::GET_THEN_INSERT)
+    ->Args({100000000, 1000000})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_groupby_sum, AggImpl::GROUPBY)
+    ->Args({100000000, 1000000})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_hash_join, true)
+    ->ArgsProduct({{1 << 20, 1 << 23, 50000000}, {10, 100}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_hash_join, false)
+    ->ArgsProduct({{1 << 20, 1 << 23, 50000000}, {10, 100}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_cache_zipf, true)->Arg(10)->Arg(100);
+BENCHMARK_TEMPLATE(BM_cache_zipf, false)->Arg(10)->Arg(100);
+
+BENCHMARK(BM_expiry_steady)->Arg(0)->Arg(256)->Arg(1024)->Iterations(5000);
+BENCHMARK_TEMPLATE(BM_multimap_build, MultiImpl::UNORDERED_MULTIMAP)
+    ->ArgsProduct({{1 << 22}, {1, 8, 64}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_multimap_build, MultiImpl::VECTOR_VALS)
+    ->ArgsProduct({{1 << 22}, {1, 8, 64}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_multimap_build, MultiImpl::MULTITBL)
+    ->ArgsProduct({{1 << 22}, {1, 8, 64}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_multimap_scan, MultiImpl::UNORDERED_MULTIMAP)
+    ->ArgsProduct({{1 << 22}, {1, 8, 64}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_multimap_scan, MultiImpl::VECTOR_VALS)
+    ->ArgsProduct({{1 << 22}, {1, 8, 64}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_multimap_scan, MultiImpl::MULTITBL)
+    ->ArgsProduct({{1 << 22}, {1, 8, 64}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_intern, true)
+    ->ArgsProduct({{10000000}, {10000, 1000000}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_intern, false)
+    ->ArgsProduct({{10000000}, {10000, 1000000}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_string_keys_insert, true)
+    ->Arg(8)
+    ->Arg(16)
+    ->Arg(32)
+    ->Arg(64)
+    ->Arg(128)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_string_keys_insert, false)
+    ->Arg(8)
+    ->Arg(16)
+    ->Arg(32)
+    ->Arg(64)
+    ->Arg(128)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_string_keys_lookup, true)
+    ->Arg(8)
+    ->Arg(16)
+    ->Arg(32)
+    ->Arg(64)
+    ->Arg(128)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_string_keys_lookup, false)
+    ->Arg(8)
+    ->Arg(16)
+    ->Arg(32)
+    ->Arg(64)
+    ->Arg(128)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_binary_keys, 13, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_binary_keys, 13, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_binary_keys, 16, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_binary_keys, 16, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_binary_keys, 32, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_binary_keys, 32, false)->Unit(benchmark::kMillisecond);
 
+BENCHMARK_TEMPLATE(BM_u32_keys_insert, true)->Arg(1 << 16)->Arg(1 << 20)->Arg(1 << 23);
+BENCHMARK_TEMPLATE(BM_u32_keys_insert, false)->Arg(1 << 16)->Arg(1 << 20)->Arg(1 << 23);
+BENCHMARK_TEMPLATE(BM_u32_keys_lookup, true)->ArgsProduct({{1 << 16, 1 << 20, 1 << 23}, {0, 100}});
+BENCHMARK_TEMPLATE(BM_u32_keys_lookup, false)->ArgsProduct({{1 << 16, 1 << 20, 1 << 23}, {0, 100}});
+BENCHMARK_TEMPLATE(BM_u32_keys_get_batch, SimdLevel::SSE2)->ArgsProduct({{1 << 16, 1 << 20, 1 << 23}, {0, 100}});
+BENCHMARK_TEMPLATE(BM_u32_keys_get_batch, SimdLevel::AVX2)->ArgsProduct({{1 << 16, 1 << 20, 1 << 23}, {0, 100}});
+BENCHMARK_TEMPLATE(BM_u32_keys_get_batch, SimdLevel::AVX512)->ArgsProduct({{1 << 16, 1 << 20, 1 << 23}, {0, 100}});
+BENCHMARK_TEMPLATE(BM_tiny_keys, uint8_t, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_tiny_keys, uint8_t, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_tiny_keys, uint16_t, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_tiny_keys, uint16_t, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_scan_ctrlchunks, SimdLevel::SSE2);
+BENCHMARK_TEMPLATE(BM_scan_ctrlchunks, SimdLevel::AVX2);
+BENCHMARK_TEMPLATE(BM_scan_ctrlchunks, SimdLevel::AVX512);
+BENCHMARK_TEMPLATE(BM_grow_under_level, SimdLevel::SSE2)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_grow_under_level, SimdLevel::AVX2)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_grow_under_level, SimdLevel::AVX512)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_group_match, __m128i);
+BENCHMARK_TEMPLATE(BM_group_match, uint64_t);
+BENCHMARK_TEMPLATE(BM_get_batch, true)->Arg(1 << 16)->Arg(1 << 22);
+BENCHMARK_TEMPLATE(BM_get_batch, false)->Arg(1 << 16)->Arg(1 << 22);
+BENCHMARK_TEMPLATE(BM_insert_batch, true)->Arg(1 << 16)->Arg(1 << 22)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_insert_batch, false)->Arg(1 << 16)->Arg(1 << 22)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_hash_batch);
+BENCHMARK_TEMPLATE(BM_reserve, true)->Arg(1 << 16)->Arg(1 << 22)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_reserve, false)->Arg(1 << 16)->Arg(1 << 22)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_grow_peak_rss, CopyGrowth)->Arg(1 << 20)->Arg(1 << 24)->Iterations(3)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_grow_peak_rss, InPlaceGrowth)->Arg(1 << 20)->Arg(1 << 24)->Iterations(3)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_rebuild_xl_vals, true)->Arg(1 << 12)->Arg(1 << 16)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_rebuild_xl_vals, false)->Arg(1 << 12)->Arg(1 << 16)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_static_lookup, true);
+BENCHMARK_TEMPLATE(BM_static_lookup, false);
 BENCHMARK_MAIN();
\ No newline at end of file
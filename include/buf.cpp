@@ -1,6 +1,7 @@
 #include "buf.hpp"
 #include <cstring>
 #include <cstdlib>
+#include <stdexcept>
 
 FlatBuf::FlatBuf()
     : data(nullptr)
@@ -10,14 +11,20 @@ FlatBuf::FlatBuf()
 void FlatBuf::grow(Layout old_layout, Layout new_layout)
 {
     if (new_layout.align > alignof(max_align_t)) {
+        // realloc() only keeps `max_align_t` alignment, so move it ourselves
         uint8_t *resized_buf;
-        if (!posix_memalign((void **)&resized_buf, new_layout.align, new_layout.size)) {
+        if (posix_memalign((void **)&resized_buf, new_layout.align, new_layout.size)) {
             throw std::runtime_error("OOM");
         }
-        memcpy(resized_buf, data, old_layout.size);
+        if (data) memcpy(resized_buf, data, old_layout.size);
+        free(data);
         data = resized_buf;
     } else {
-        data = (uint8_t *)realloc(data, new_layout.size);
+        // Big buffers are their own mappings, which glibc grows with mremap(),
+        // so this usually doesn't copy (or need room for both) at all
+        uint8_t *resized_buf = (uint8_t *)realloc(data, new_layout.size);
+        if (!resized_buf) throw std::runtime_error("OOM");
+        data = resized_buf;
     }
 }
 
@@ -22,7 +22,7 @@ struct FlatBuf
 
     /**
      * `realloc()` the contents of this buffer, without intializing the extra
-     * space. throw OOM on realloc fail. 
+     * space. throw OOM on realloc fail, leaving the buffer as it was.
      */
     void grow(Layout, Layout);
 
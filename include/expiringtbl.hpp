@@ -0,0 +1,144 @@
+#pragma once
+
+#include "hashmap.hpp"
+
+/**
+ * A value along with when it expires. The expiry is a 32-bit tick count in
+ * whatever unit the caller likes (seconds, say), so that it only adds 4 bytes
+ * (often none, after padding) to an entry.
+ */
+template <typename Val> struct Expiring
+{
+    uint32_t expires_at;
+    Val val;
+};
+
+/**
+ * A `HashTbl` whose entries expire.
+ *
+ * Nothing ever scans the whole table. Lookups expire the entry they land on
+ * lazily, and `sweep()` reclaims expired entries that nobody looks up a
+ * bounded number of ctrl chunks at a time, picking up where the last call
+ * left off. Call it every so often (e.g. once per tick) with a budget big
+ * enough to get round the table about once per TTL.
+ *
+ * Ticks compare with serial number arithmetic, so they may wrap around, as
+ * long as no expiry is more than 2^31 ticks away.
+ */
+template <typename Key, typename Val> class ExpiringTbl
+{
+public:
+    typedef HashTbl<Key, Expiring<Val>> tbl_t;
+    typedef typename tbl_t::Entry Entry;
+
+private:
+    tbl_t tbl;
+    /** The ctrl chunk the next `sweep()` starts at */
+    size_t sweep_cursor;
+
+    static bool is_expired(uint32_t expires_at, uint32_t now)
+    {
+        return (int32_t)(expires_at - now) <= 0;
+    }
+
+    /** The entry at `key`, expiring it if it's due */
+    Entry *get_live(Key const &key, uint32_t now)
+    {
+        size_t h = is_hashable<Key>::hash(key);
+        Entry *slot;
+        char *ctrl_slot;
+        if (tbl.get_slot(h, key, slot, ctrl_slot)) return nullptr;
+        if (is_expired(slot->val.expires_at, now)) {
+            tbl.release_slot(h, ctrl_slot);
+            slot->~Entry();
+            return nullptr;
+        }
+        return slot;
+    }
+
+public:
+    ExpiringTbl()
+        : sweep_cursor(0)
+    {
+    }
+
+    /**
+     * Insert a key-value pair that expires at tick `expires_at`, overriding
+     * an existing value (and its expiry) if there is one.
+     *
+     * # Returns
+     * A pointer to the value
+     */
+    Val *insert(Key key, Val val, uint32_t expires_at)
+    {
+        Expiring<Val> *e = tbl.insert(std::move(key), Expiring<Val>{expires_at, std::move(val)});
+        return &e->val;
+    }
+
+    /**
+     * Get a pointer to the value at this key, or `nullptr` if it does not
+     * exist or has expired by tick `now`. An expired entry is removed on the
+     * spot.
+     */
+    Val *get(Key const &key, uint32_t now)
+    {
+        Entry *slot = get_live(key, now);
+        return slot ? &slot->val.val : nullptr;
+    }
+
+    /**
+     * Push back the expiry of the entry at `key` to `expires_at`, if it
+     * hasn't expired by tick `now`.
+     *
+     * # Returns
+     * Whether there was such an entry
+     */
+    bool extend(Key const &key, uint32_t now, uint32_t expires_at)
+    {
+        Entry *slot = get_live(key, now);
+        if (!slot) return false;
+        slot->val.expires_at = expires_at;
+        return true;
+    }
+
+    void remove(Key const &key)
+    {
+        tbl.remove(key);
+    }
+
+    /**
+     * Reclaim the expired entries in the next `max_ctrlchunks` ctrl chunks.
+     * Stops early at the end of the table, so that the next call starts again
+     * from the beginning.
+     *
+     * # Returns
+     * The number of reclaimed entries
+     */
+    size_t sweep(uint32_t now, size_t max_ctrlchunks)
+    {
+        // The table might have grown or been emptied since the last call
+        if (sweep_cursor >= tbl.nr_ctrlchunks()) sweep_cursor = 0;
+        size_t to = sweep_cursor + max_ctrlchunks;
+        if (to > tbl.nr_ctrlchunks()) to = tbl.nr_ctrlchunks();
+        size_t nr_reclaimed =
+            tbl.erase_if_range(sweep_cursor, to, [now](Key const &, Expiring<Val> &e) {
+                return is_expired(e.expires_at, now);
+            });
+        sweep_cursor = to;
+        return nr_reclaimed;
+    }
+
+    /**
+     * The number of entries, counting expired ones that haven't been
+     * reclaimed yet.
+     */
+    size_t size() const
+    {
+        return tbl.size();
+    }
+
+    size_t nr_ctrlchunks() const
+    {
+        return tbl.nr_ctrlchunks();
+    }
+};
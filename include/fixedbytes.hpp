@@ -0,0 +1,171 @@
+#pragma once
+
+#include "hashmap.hpp"
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+/**
+ * An `N`-byte binary key, e.g. a 16-byte UUID or a 13-byte network 5-tuple.
+ *
+ * The bytes are padded with zeros to a multiple of 16 (but not aligned, so
+ * that entries don't grow), so that comparing and hashing are whole 16-byte
+ * loads with no tail handling: a single compare for `N <= 16`, and two (or
+ * one 32-byte compare with AVX2) for `N <= 32`. Without SSE2, they're a
+ * `memcpy()` and a `memcmp()` of the padded bytes.
+ */
+template <size_t N> struct FixedBytes
+{
+    static const size_t NR_LANES = (N + 15) / 16;
+    static const size_t STORAGE_LEN = NR_LANES * 16;
+
+    uint8_t bytes[STORAGE_LEN];
+
+    FixedBytes()
+        : bytes()
+    {
+    }
+
+    /** Copy the `N` bytes at `data` */
+    explicit FixedBytes(void const *data)
+    {
+#ifdef __SSE2__
+        uint8_t const *src = (uint8_t const *)data;
+        for (size_t i = 0; i < NR_LANES; ++i) {
+            size_t len = N - i * 16 < 16 ? N - i * 16 : 16;
+            _mm_storeu_si128((__m128i *)bytes + i, load_lane(src + i * 16, len));
+        }
+#else
+        memcpy(bytes, data, N);
+        memset(bytes + N, 0, STORAGE_LEN - N);
+#endif
+    }
+
+#ifdef __SSE2__
+    /**
+     * Load `len` (at most 16) bytes into the low bytes of a vector, zeroing
+     * the rest, without reading past them. A short key has to become a whole
+     * vector in registers and be stored in one go: storing it piecewise and
+     * then loading it whole (as every compare and hash does) stalls on store
+     * forwarding, which made 13-byte keys several times slower than 16-byte
+     * ones.
+     */
+    static __m128i load_lane(uint8_t const *src, size_t len)
+    {
+        if (len == 16) return _mm_loadu_si128((__m128i const *)src);
+        if (len > 8) {
+            // Both words overlap in the middle, so shift the overlap out
+            uint64_t lo = load_u64(src);
+            uint64_t hi = load_u64(src + len - 8) >> (8 * (16 - len));
+            return _mm_set_epi64x(hi, lo);
+        }
+        return _mm_cvtsi64_si128(load_short(src, len));
+    }
+
+    static uint64_t load_u64(uint8_t const *src)
+    {
+        uint64_t word;
+        memcpy(&word, src, sizeof(uint64_t));
+        return word;
+    }
+
+    static uint32_t load_u32(uint8_t const *src)
+    {
+        uint32_t word;
+        memcpy(&word, src, sizeof(uint32_t));
+        return word;
+    }
+
+    /** Up to 8 bytes, again with overlapping loads that agree on the overlap */
+    static uint64_t load_short(uint8_t const *src, size_t len)
+    {
+        if (len == 8) return load_u64(src);
+        if (len >= 4) {
+            return load_u32(src) | ((uint64_t)load_u32(src + len - 4) << (8 * (len - 4)));
+        }
+        if (len == 0) return 0;
+        return src[0] | ((uint64_t)src[len / 2] << (8 * (len / 2))) |
+               ((uint64_t)src[len - 1] << (8 * (len - 1)));
+    }
+
+    __m128i lane(size_t i) const
+    {
+        return _mm_loadu_si128((__m128i const *)bytes + i);
+    }
+#endif
+
+    /**
+     * The AVX2 compare is only used when the whole program is built for AVX2,
+     * rather than picked at runtime like the `simd_kernels()`: this runs once
+     * per probe, from inside `HashTbl`, which has no way to pick a level once
+     * per table, and an indirect call per probe costs far more than one
+     * compare instead of two saves. Nearly every call is on a real hit
+     * anyway, since `HashTbl` compares the cached hashes first.
+     */
+    bool operator==(FixedBytes const &other) const
+    {
+#ifdef __SSE2__
+#ifdef __AVX2__
+        if (NR_LANES == 2) {
+            __m256i a = _mm256_loadu_si256((__m256i const *)bytes);
+            __m256i b = _mm256_loadu_si256((__m256i const *)other.bytes);
+            return _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)) == -1;
+        }
+#endif
+        __m128i eq = _mm_cmpeq_epi8(lane(0), other.lane(0));
+        for (size_t i = 1; i < NR_LANES; ++i) {
+            eq = _mm_and_si128(eq, _mm_cmpeq_epi8(lane(i), other.lane(i)));
+        }
+        return _mm_movemask_epi8(eq) == 0xffff;
+#else
+        return memcmp(bytes, other.bytes, STORAGE_LEN) == 0;
+#endif
+    }
+
+    bool operator!=(FixedBytes const &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+/**
+ * Fold a 64x64 -> 128-bit product back down to 64 bits, so that every input
+ * bit affects the low bits.
+ */
+inline size_t fold_mul(uint64_t a, uint64_t b)
+{
+    unsigned __int128 product = (unsigned __int128)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+template <size_t N> struct is_hashable<FixedBytes<N>>
+{
+    static constexpr bool value = true;
+
+    /**
+     * One folded multiply per 16 bytes, combining both halves of the lane
+     * at once rather than mixing in one word at a time like `hash_bytes()`.
+     */
+    static size_t hash(FixedBytes<N> const &key)
+    {
+        size_t h = N * 0x9e3779b97f4a7c15;
+        for (size_t i = 0; i < FixedBytes<N>::NR_LANES; ++i) {
+            uint64_t lo, hi;
+            memcpy(&lo, key.bytes + i * 16, sizeof(uint64_t));
+            memcpy(&hi, key.bytes + i * 16 + 8, sizeof(uint64_t));
+            h = fold_mul(lo ^ h ^ 0xa0761d6478bd642f, hi ^ 0xe7037ed1a0b428db);
+        }
+        return h;
+    }
+};
+
+// Comparing the cached hashes first is cheaper than even a vector compare,
+// and it rules out nearly every h7 false positive
+template <size_t N> struct is_trivially_equatable<FixedBytes<N>>
+{
+    static constexpr bool value = true;
+};
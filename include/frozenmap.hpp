@@ -0,0 +1,200 @@
+#pragma once
+
+#include "hashmap.hpp"
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Keys a `FrozenMap` can hash and compare at compile time. Unlike
+ * `is_hashable`, the hash takes a seed, so that `FrozenMap` can try a few
+ * until its keys spread out the way it wants.
+ */
+template <typename T, typename = void> struct is_frozen_hashable
+{
+    static constexpr bool value = false;
+};
+
+/** The 64-bit murmur3 finalizer, so that every bit of `h` reaches every other */
+constexpr size_t frozen_mix(size_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccd;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53;
+    h ^= h >> 33;
+    return h;
+}
+
+template <typename T>
+struct is_frozen_hashable<T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type>
+{
+    static constexpr bool value = true;
+
+    static constexpr size_t hash(T key, size_t seed)
+    {
+        return frozen_mix((size_t)key ^ seed * 0x9e3779b97f4a7c15);
+    }
+
+    static constexpr bool eq(T a, T b)
+    {
+        return a == b;
+    }
+};
+
+/**
+ * A byte at a time, since `memcpy()` isn't allowed at compile time. Frozen
+ * keys tend to be short names, so this hardly matters at runtime.
+ */
+template <> struct is_frozen_hashable<std::string_view>
+{
+    static constexpr bool value = true;
+
+    static constexpr size_t hash(std::string_view const &key, size_t seed)
+    {
+        size_t h = key.size() * 0x9e3779b97f4a7c15 ^ seed;
+        for (size_t i = 0; i < key.size(); ++i) {
+            h = (h ^ (uint8_t)key[i]) * 0x100000001b3;
+        }
+        return frozen_mix(h);
+    }
+
+    static constexpr bool eq(std::string_view const &a, std::string_view const &b)
+    {
+        return a == b;
+    }
+};
+
+/**
+ * A read-only map of `N` keys, built entirely at compile time, for the small
+ * static lookup tables (opcode to handler, header name to enum...) that we'd
+ * otherwise fill with `insert()`s at startup. Declared `constexpr`, it's just
+ * bytes in `.rodata` (`.data.rel.ro` in a PIE if it holds pointers), with
+ * nothing to run before `main()`.
+ *
+ * It has the same ctrl chunks of h7 tags as `HashTbl`, at most half full, but
+ * no overflow counts or probing: the constructor tries seeds until every key
+ * lands in its home chunk, so a lookup is always one tag match in one chunk.
+ * `Key` and `Val` have to be literal types with default constructors.
+ */
+template <typename Key, typename Val, size_t N> class FrozenMap
+{
+    static_assert(is_frozen_hashable<Key>::value, "Key must be an integer, an enum or a std::string_view");
+    static_assert(N > 0, "A FrozenMap needs at least one key");
+
+public:
+    static constexpr size_t NR_CTRLCHUNKS =
+        nextpow2((N + CtrlChunk::NR_BYTES / 2 - 1) / (CtrlChunk::NR_BYTES / 2));
+    static constexpr size_t NR_SLOTS = NR_CTRLCHUNKS * CtrlChunk::NR_BYTES;
+    /** How many seeds we try before giving up on the keys */
+    static constexpr size_t MAX_SEEDS = 1 << 12;
+
+    struct Entry
+    {
+        Key key{};
+        Val val{};
+    };
+
+private:
+    alignas(CtrlChunk) char ctrl[NR_SLOTS];
+    Entry entries[NR_SLOTS];
+    size_t seed;
+
+    static constexpr char h7(size_t hash)
+    {
+        return (char)(hash & 0b1111111);
+    }
+
+    static constexpr size_t home_ctrlchunk_idx(size_t hash)
+    {
+        // The low 7 bits are the tag already
+        return (hash >> 7) & (NR_CTRLCHUNKS - 1);
+    }
+
+    /** Whether every one of `items` fits in its home chunk with `seed` */
+    static constexpr bool seed_fits(std::pair<Key, Val> const *items, size_t seed)
+    {
+        size_t nr_in_chunk[NR_CTRLCHUNKS] = {};
+        for (size_t i = 0; i < N; ++i) {
+            size_t h = is_frozen_hashable<Key>::hash(items[i].first, seed);
+            if (++nr_in_chunk[home_ctrlchunk_idx(h)] > CtrlChunk::NR_BYTES) return false;
+        }
+        return true;
+    }
+
+public:
+    /**
+     * Build the map from the `N` key-value pairs at `items`. Throws (which
+     * means a compile error, in a constant expression) if a key repeats or no
+     * seed works.
+     */
+    constexpr explicit FrozenMap(std::pair<Key, Val> const *items)
+        : ctrl()
+        , entries()
+        , seed(0)
+    {
+        while (!seed_fits(items, seed)) {
+            if (++seed == MAX_SEEDS) throw std::runtime_error("no seed fits the keys");
+        }
+        for (size_t i = 0; i < NR_SLOTS; ++i) {
+            ctrl[i] = CtrlChunk::CTRL_EMPTY;
+        }
+        for (size_t i = 0; i < N; ++i) {
+            size_t h = is_frozen_hashable<Key>::hash(items[i].first, seed);
+            size_t slot_idx = home_ctrlchunk_idx(h) * CtrlChunk::NR_BYTES;
+            // Equal keys have equal hashes, so any duplicate is in this chunk
+            for (; ctrl[slot_idx] != CtrlChunk::CTRL_EMPTY; ++slot_idx) {
+                if (is_frozen_hashable<Key>::eq(entries[slot_idx].key, items[i].first)) {
+                    throw std::runtime_error("duplicate key");
+                }
+            }
+            ctrl[slot_idx] = h7(h);
+            entries[slot_idx] = Entry{items[i].first, items[i].second};
+        }
+    }
+
+    /**
+     * Get a pointer to the value at this key, or `nullptr` if it does not
+     * exist.
+     */
+    Val const *get(Key const &key) const
+    {
+        size_t h = is_frozen_hashable<Key>::hash(key, seed);
+        size_t ctrlchunk_idx = home_ctrlchunk_idx(h);
+        size_t aligned_entry_idx = ctrlchunk_idx * CtrlChunk::NR_BYTES;
+        ctrlchunk_t ctrlchunk = ((CtrlChunk const *)ctrl)[ctrlchunk_idx].as_simd();
+        ctrlmask_t hit_mask = simd<ctrlchunk_t>::movemask_eq(ctrlchunk, h7(h));
+        while (hit_mask) {
+            Entry const &entry = entries[aligned_entry_idx + CtrlChunk::mask_ctz(hit_mask)];
+            if (entry.key == key) return &entry.val;
+            hit_mask &= hit_mask - 1;
+        }
+        return nullptr;
+    }
+
+    constexpr size_t size() const
+    {
+        return N;
+    }
+
+    /** The seed the constructor settled on */
+    constexpr size_t hash_seed() const
+    {
+        return seed;
+    }
+};
+
+/**
+ * Build a `FrozenMap` from a braced list of pairs, e.g.
+ *
+ *     constexpr auto METHODS = make_frozen_map<std::string_view, Method>({
+ *         {"GET", Method::GET},
+ *         {"PUT", Method::PUT},
+ *     });
+ */
+template <typename Key, typename Val, size_t N>
+constexpr FrozenMap<Key, Val, N> make_frozen_map(std::pair<Key, Val> const (&items)[N])
+{
+    return FrozenMap<Key, Val, N>(items);
+}
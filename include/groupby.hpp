@@ -0,0 +1,141 @@
+#pragma once
+
+#include "hashmap.hpp"
+
+/**
+ * Aggregations for `GroupBy`. `init(v)` makes the accumulator for a group from
+ * its first value, `update(acc, v)` folds every later value in.
+ */
+template <typename T> struct SumAgg
+{
+    typedef T acc_t;
+
+    static acc_t init(T const &v)
+    {
+        return v;
+    }
+
+    static void update(acc_t &acc, T const &v)
+    {
+        acc += v;
+    }
+};
+
+template <typename T> struct CountAgg
+{
+    typedef size_t acc_t;
+
+    static acc_t init(T const &)
+    {
+        return 1;
+    }
+
+    static void update(acc_t &acc, T const &)
+    {
+        acc++;
+    }
+};
+
+template <typename T> struct MinAgg
+{
+    typedef T acc_t;
+
+    static acc_t init(T const &v)
+    {
+        return v;
+    }
+
+    static void update(acc_t &acc, T const &v)
+    {
+        if (v < acc) acc = v;
+    }
+};
+
+template <typename T> struct MaxAgg
+{
+    typedef T acc_t;
+
+    static acc_t init(T const &v)
+    {
+        return v;
+    }
+
+    static void update(acc_t &acc, T const &v)
+    {
+        if (acc < v) acc = v;
+    }
+};
+
+/**
+ * Hash aggregation over columnar input: feed it arrays of keys and values
+ * with `ingest()`, and read out one accumulator per distinct key.
+ *
+ * Rows are handled in batches of `BATCH_SIZE`. We hash the whole batch first
+ * and `prefetch()` the row `PREFETCH_DISTANCE` ahead of the one we're
+ * `upsert()`-ing, so that once there are more groups than fit in cache we
+ * have several misses in flight instead of stalling on every row.
+ */
+template <typename Key, typename Val, typename Agg = SumAgg<Val>> class GroupBy
+{
+public:
+    typedef typename Agg::acc_t acc_t;
+    typedef HashTbl<Key, acc_t> tbl_t;
+
+    static const size_t BATCH_SIZE = 256;
+    static const size_t PREFETCH_DISTANCE = 8;
+
+private:
+    tbl_t tbl;
+    size_t hashes[BATCH_SIZE];
+
+public:
+    void ingest(Key const *keys, Val const *vals, size_t nr_rows)
+    {
+        for (size_t batch = 0; batch < nr_rows; batch += BATCH_SIZE) {
+            size_t n = nr_rows - batch < BATCH_SIZE ? nr_rows - batch : BATCH_SIZE;
+            Key const *ks = keys + batch;
+            Val const *vs = vals + batch;
+            hash_batch(ks, n, hashes);
+            for (size_t i = 0; i < PREFETCH_DISTANCE && i < n; ++i) {
+                tbl.prefetch(hashes[i]);
+            }
+            for (size_t i = 0; i < n; ++i) {
+                if (i + PREFETCH_DISTANCE < n) tbl.prefetch(hashes[i + PREFETCH_DISTANCE]);
+                Val const &v = vs[i];
+                tbl.upsert_hashed(hashes[i], ks[i], Agg::init(v),
+                                  [&v](acc_t &acc) { Agg::update(acc, v); });
+            }
+        }
+    }
+
+    size_t size() const
+    {
+        return tbl.size();
+    }
+
+    /**
+     * The accumulator for `key`, or `nullptr` if we never saw it.
+     */
+    acc_t *get(Key const &key)
+    {
+        return tbl.get(key);
+    }
+
+    /**
+     * Call `f(key, acc)` once for every group.
+     */
+    template <typename F> void emit(F f) const
+    {
+        for (auto kv : tbl) {
+            f(kv.first, kv.second);
+        }
+    }
+
+    /**
+     * The underlying table, e.g. to `merge()` per-thread partial aggregates.
+     */
+    tbl_t &table()
+    {
+        return tbl;
+    }
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "hashmap.hpp"
+#include <vector>
+
+/**
+ * A fixed-size cache on top of `HashTbl`, evicting with CLOCK (second chance)
+ * rather than exact LRU.
+ *
+ * Each slot of the table gets a reference bit in a side bitmap, set whenever
+ * its entry is hit. The cache is 16-way set associative: a key only ever
+ * lives in its home ctrl chunk, so a lookup looks at exactly one ctrl chunk,
+ * and every slot of the table can be used. When a new key's home chunk is
+ * full, that chunk's clock hand sweeps over its slots, clearing reference bits
+ * as it goes, and the first entry whose bit was already clear is evicted in
+ * place. There are no per-entry allocations or list nodes, and a hit is a
+ * single lookup plus setting a bit.
+ *
+ * (A single clock hand sweeping the whole table doesn't work here: the chunks
+ * just ahead of the hand have been filling up for a whole lap, so they
+ * overflow into long runs of full chunks.)
+ */
+template <typename Key, typename Val> class HashCache
+{
+public:
+    typedef HashTbl<Key, Val> tbl_t;
+    typedef typename tbl_t::Entry Entry;
+
+    struct Stats
+    {
+        size_t hits;
+        size_t misses;
+        size_t evictions;
+
+        double hit_rate() const
+        {
+            return hits + misses ? (double)hits / (hits + misses) : 0;
+        }
+    };
+
+private:
+    tbl_t tbl;
+    /** One bit per slot of `tbl`, so `CtrlChunk::NR_BYTES` consecutive bits per ctrl chunk */
+    std::vector<uint64_t> ref_bits;
+    /** The offset of each ctrl chunk's clock hand */
+    std::vector<uint8_t> hands;
+    Stats stats;
+
+    static const size_t CHUNKS_PER_WORD = 64 / CtrlChunk::NR_BYTES;
+    static const ctrlmask_t FULL_MASK = (ctrlmask_t)~(ctrlmask_t)0;
+
+    static size_t capacity_for_budget(size_t budget_bytes)
+    {
+        // An entry, its ctrl byte and its reference bit, plus a clock hand
+        // per ctrl chunk. The occupancy and overflow bytes are per ctrl chunk
+        // too, and small enough to ignore.
+        size_t chunk_bits = CtrlChunk::NR_BYTES * (sizeof(Entry) * 8 + 8 + 1) + 8;
+        size_t nr_ctrlchunks = budget_bytes * 8 / chunk_bits;
+        return (nr_ctrlchunks ? nr_ctrlchunks : 1) * CtrlChunk::NR_BYTES;
+    }
+
+    static ctrlmask_t rotr(ctrlmask_t mask, size_t n)
+    {
+        return n ? (ctrlmask_t)((mask >> n) | (mask << (CtrlChunk::NR_BYTES - n))) : mask;
+    }
+
+    static ctrlmask_t rotl(ctrlmask_t mask, size_t n)
+    {
+        return n ? (ctrlmask_t)((mask << n) | (mask >> (CtrlChunk::NR_BYTES - n))) : mask;
+    }
+
+    ctrlmask_t chunk_ref_bits(size_t ctrlchunk_idx) const
+    {
+        return (ctrlmask_t)(ref_bits[ctrlchunk_idx / CHUNKS_PER_WORD] >>
+                            (ctrlchunk_idx % CHUNKS_PER_WORD * CtrlChunk::NR_BYTES));
+    }
+
+    void clear_chunk_ref_bits(size_t ctrlchunk_idx, ctrlmask_t mask)
+    {
+        ref_bits[ctrlchunk_idx / CHUNKS_PER_WORD] &=
+            ~((uint64_t)mask << (ctrlchunk_idx % CHUNKS_PER_WORD * CtrlChunk::NR_BYTES));
+    }
+
+    void set_ref_bit(char const *ctrl_slot)
+    {
+        size_t idx = tbl.slot_idx_of(ctrl_slot);
+        ref_bits[idx / 64] |= (uint64_t)1 << (idx % 64);
+    }
+
+    /**
+     * Evict an entry from the full ctrl chunk `ctrlchunk_idx`: advance its
+     * clock hand to the first entry without its reference bit set, clearing
+     * the bits of every entry it passes.
+     */
+    void evict(size_t ctrlchunk_idx)
+    {
+        size_t hand = hands[ctrlchunk_idx];
+        // Rotate so that bit 0 is the slot under the hand
+        ctrlmask_t refs = rotr(chunk_ref_bits(ctrlchunk_idx), hand);
+        ctrlmask_t victim_mask = ~refs;
+        size_t victim = 0;
+        if (victim_mask) {
+            victim = CtrlChunk::mask_ctz(victim_mask);
+            clear_chunk_ref_bits(ctrlchunk_idx, rotl((ctrlmask_t)((1u << victim) - 1), hand));
+        } else {
+            // Everything was referenced, so after a full turn we're back at
+            // the hand
+            clear_chunk_ref_bits(ctrlchunk_idx, FULL_MASK);
+        }
+        size_t ctrlbyte_offset = (hand + victim) % CtrlChunk::NR_BYTES;
+        hands[ctrlchunk_idx] = (ctrlbyte_offset + 1) % CtrlChunk::NR_BYTES;
+
+        CtrlChunk *ctrlchunk = tbl.ctrlchunk_at(ctrlchunk_idx);
+        Entry *entry = tbl.entry_at(ctrlchunk_idx * CtrlChunk::NR_BYTES + ctrlbyte_offset);
+        tbl.release_slot(entry->hash, &ctrlchunk->byte_at(ctrlbyte_offset));
+        entry->~Entry();
+        stats.evictions++;
+    }
+
+public:
+    /**
+     * A cache whose table takes up about `budget_bytes`. Anything the keys
+     * and values own on the heap isn't counted.
+     */
+    explicit HashCache(size_t budget_bytes)
+        : tbl(tbl_t::with_capacity(capacity_for_budget(budget_bytes)))
+        , stats()
+    {
+        ref_bits.assign(alignup(tbl.nr_ctrlchunks(), CHUNKS_PER_WORD) / CHUNKS_PER_WORD, 0);
+        hands.assign(tbl.nr_ctrlchunks(), 0);
+    }
+
+    /**
+     * Get a pointer to the value at this key, or `nullptr` if it's not cached.
+     * Counts as a hit or miss.
+     */
+    Val *get(Key const &key)
+    {
+        size_t h = is_hashable<Key>::hash(key);
+        Entry *slot;
+        char *ctrl_slot;
+        if (tbl.get_slot(h, key, slot, ctrl_slot)) {
+            stats.misses++;
+            return nullptr;
+        }
+        stats.hits++;
+        set_ref_bit(ctrl_slot);
+        return &slot->val;
+    }
+
+    /**
+     * Cache `val` at `key`, evicting another entry if its set is full. A new
+     * entry starts without its reference bit set, so entries that are only
+     * ever used once don't push out ones that are used again.
+     *
+     * # Returns
+     * A pointer to the value
+     */
+    Val *put(Key key, Val val)
+    {
+        size_t h = is_hashable<Key>::hash(key);
+        Entry *slot;
+        char *ctrl_slot;
+        if (!tbl.get_slot(h, key, slot, ctrl_slot)) {
+            slot->val = std::move(val);
+            set_ref_bit(ctrl_slot);
+            return &slot->val;
+        }
+        // Making room in the home chunk means `claim_empty_slot` never has to
+        // probe past it, so no overflow count is ever bumped
+        size_t ctrlchunk_idx = tbl.home_ctrlchunk_idx(h);
+        if (tbl.ctrlchunk_at(ctrlchunk_idx)->present_mask() == FULL_MASK) evict(ctrlchunk_idx);
+        slot = tbl.claim_empty_slot(h);
+        new (slot) Entry(h, std::move(key), std::move(val));
+        return &slot->val;
+    }
+
+    /**
+     * Drop the entry at `key`, if there is one.
+     */
+    void remove(Key const &key)
+    {
+        size_t h = is_hashable<Key>::hash(key);
+        Entry *slot;
+        char *ctrl_slot;
+        if (tbl.get_slot(h, key, slot, ctrl_slot)) return;
+        // Empty slots never have their reference bit set, so that whatever
+        // goes in next starts without it
+        size_t idx = tbl.slot_idx_of(ctrl_slot);
+        ref_bits[idx / 64] &= ~((uint64_t)1 << (idx % 64));
+        tbl.release_slot(h, ctrl_slot);
+        slot->~Entry();
+    }
+
+    size_t size() const
+    {
+        return tbl.size();
+    }
+
+    /** The most entries we'll hold at once */
+    size_t capacity() const
+    {
+        return tbl.nr_ctrlchunks() * CtrlChunk::NR_BYTES;
+    }
+
+    Stats const &get_stats() const
+    {
+        return stats;
+    }
+
+    void reset_stats()
+    {
+        stats = Stats();
+    }
+};
@@ -0,0 +1,240 @@
+#pragma once
+
+#include "hashmap.hpp"
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+/**
+ * An in-memory equi-join: `build()` a table over one side, then `probe()` it
+ * with the other, getting a callback for every matching pair of payloads.
+ * Build keys don't have to be unique.
+ *
+ * When the build side is much bigger than the caches, every probe misses on
+ * the table. So both sides are radix-partitioned on the high bits of a mixed
+ * hash first, and each partition gets its own `HashTbl`, small enough to stay
+ * cache-resident while we probe it. Partitions are built in parallel. With
+ * `radix_bits == 0` there is a single partition, i.e. a plain hash join.
+ */
+template <typename Key, typename Payload> class HashJoin
+{
+public:
+    /** Pick the number of partitions from the build side size */
+    static const size_t AUTO_RADIX_BITS = ~(size_t)0;
+    /** About how many build rows we aim for per partition */
+    static const size_t TARGET_PARTITION_ROWS = 1 << 14;
+    static const size_t MAX_RADIX_BITS = 12;
+    static const size_t BATCH_SIZE = 256;
+    static const size_t PREFETCH_DISTANCE = 8;
+
+private:
+    /** Ends a chain of build rows with the same key */
+    static const uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    /**
+     * The table maps each key to the index of its last build row, and `next`
+     * chains every build row to the previous one with the same key.
+     */
+    typedef HashTbl<Key, uint32_t> tbl_t;
+
+    struct Partition
+    {
+        std::vector<Key> keys;
+        std::vector<Payload> payloads;
+        std::vector<uint32_t> next;
+        std::unique_ptr<tbl_t> tbl;
+    };
+
+    size_t requested_radix_bits;
+    /** What `requested_radix_bits` came to for the current build side */
+    size_t radix_bits;
+    size_t nr_threads;
+    std::vector<Partition> partitions;
+
+    size_t partition_of(size_t h) const
+    {
+        // The hash is the identity for integers, so mix before taking the high
+        // bits (and keep them independent of the low bits the tables use)
+        return radix_bits ? (h * 0x9e3779b97f4a7c15) >> (64 - radix_bits) : 0;
+    }
+
+    /**
+     * Scatter `keys` and `payloads` into one `Partition` per radix. Two
+     * passes: count the rows of each partition, then copy each row into
+     * place.
+     */
+    void partition(Key const *keys, Payload const *payloads, size_t n,
+                   std::vector<Partition> &dst) const
+    {
+        std::vector<size_t> counts(dst.size(), 0);
+        for (size_t i = 0; i < n; ++i) {
+            counts[partition_of(is_hashable<Key>::hash(keys[i]))]++;
+        }
+        for (size_t p = 0; p < dst.size(); ++p) {
+            dst[p].keys.reserve(counts[p]);
+            dst[p].payloads.reserve(counts[p]);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            Partition &part = dst[partition_of(is_hashable<Key>::hash(keys[i]))];
+            part.keys.push_back(keys[i]);
+            part.payloads.push_back(payloads[i]);
+        }
+    }
+
+    /** `part` must have fewer than `NONE` rows, see `build()` */
+    static void build_partition(Partition &part)
+    {
+        size_t n = part.keys.size();
+        // We know how many rows there are, so size the table once. We size
+        // for every row being a distinct key rather than in `grow()`-sized
+        // steps, or a 50M row build side wouldn't fit in memory.
+        part.tbl.reset(new tbl_t(tbl_t::with_capacity(n / 3 * 4 + CtrlChunk::NR_BYTES * 4)));
+        part.next.assign(n, (uint32_t)NONE);
+        for (uint32_t i = 0; i < n; ++i) {
+            std::vector<uint32_t> &next = part.next;
+            part.tbl->upsert(part.keys[i], i, [&next, i](uint32_t &last) {
+                next[i] = last;
+                last = i;
+            });
+        }
+    }
+
+    /**
+     * Probe `part` with `n` rows, prefetching `PREFETCH_DISTANCE` rows ahead.
+     */
+    template <typename F>
+    static size_t probe_partition(Partition &part, Key const *keys, Payload const *payloads,
+                                  size_t n, F &emit)
+    {
+        typedef typename tbl_t::Entry Entry;
+
+        size_t nr_matches = 0;
+        size_t hashes[BATCH_SIZE];
+        tbl_t &tbl = *part.tbl;
+        for (size_t batch = 0; batch < n; batch += BATCH_SIZE) {
+            size_t batch_len = n - batch < BATCH_SIZE ? n - batch : BATCH_SIZE;
+            Key const *ks = keys + batch;
+            Payload const *ps = payloads + batch;
+            hash_batch(ks, batch_len, hashes);
+            for (size_t i = 0; i < PREFETCH_DISTANCE && i < batch_len; ++i) {
+                tbl.prefetch(hashes[i]);
+            }
+            for (size_t i = 0; i < batch_len; ++i) {
+                if (i + PREFETCH_DISTANCE < batch_len) tbl.prefetch(hashes[i + PREFETCH_DISTANCE]);
+                Entry *slot;
+                char *ctrl_slot;
+                if (tbl.get_slot(hashes[i], ks[i], slot, ctrl_slot)) continue;
+                for (uint32_t row = slot->val; row != NONE; row = part.next[row]) {
+                    emit(part.payloads[row], ps[i]);
+                    nr_matches++;
+                }
+            }
+        }
+        return nr_matches;
+    }
+
+public:
+    /**
+     * `radix_bits` of 0 disables partitioning. `nr_threads` of 0 uses one
+     * per core.
+     */
+    explicit HashJoin(size_t radix_bits = AUTO_RADIX_BITS, size_t nr_threads = 0)
+        : requested_radix_bits(radix_bits)
+        , radix_bits(0)
+        , nr_threads(nr_threads ? nr_threads : std::thread::hardware_concurrency())
+    {
+        if (this->nr_threads == 0) this->nr_threads = 1;
+    }
+
+    /**
+     * The number of radix bits that gets partitions of about
+     * `TARGET_PARTITION_ROWS` build rows.
+     */
+    static size_t radix_bits_for(size_t nr_build_rows)
+    {
+        size_t bits = 0;
+        while (bits < MAX_RADIX_BITS && (nr_build_rows >> bits) > TARGET_PARTITION_ROWS) {
+            bits++;
+        }
+        return bits;
+    }
+
+    size_t nr_partitions() const
+    {
+        return partitions.size();
+    }
+
+    /**
+     * Build the join tables over `n` rows, replacing any previous build side.
+     */
+    void build(Key const *keys, Payload const *payloads, size_t n)
+    {
+        radix_bits = requested_radix_bits == AUTO_RADIX_BITS ? radix_bits_for(n)
+                                                             : requested_radix_bits;
+        if (radix_bits > MAX_RADIX_BITS) throw std::runtime_error("too many radix bits");
+        partitions = std::vector<Partition>((size_t)1 << radix_bits);
+        partition(keys, payloads, n, partitions);
+        // Check before any worker starts, so a bad build side fails here
+        for (Partition const &part : partitions) {
+            if (part.keys.size() >= NONE) throw std::runtime_error("partition too big");
+        }
+
+        size_t nr_workers = std::min(nr_threads, partitions.size());
+        if (nr_workers <= 1) {
+            for (Partition &part : partitions) {
+                build_partition(part);
+            }
+            return;
+        }
+        // An exception escaping a thread would terminate the process, so each
+        // worker hands back whatever it throws (running out of memory, say)
+        // for us to rethrow once they've all finished
+        std::vector<std::exception_ptr> errors(nr_workers);
+        std::vector<std::thread> workers;
+        for (size_t w = 0; w < nr_workers; ++w) {
+            workers.emplace_back([this, w, nr_workers, &errors]() {
+                try {
+                    for (size_t p = w; p < partitions.size(); p += nr_workers) {
+                        build_partition(partitions[p]);
+                    }
+                } catch (...) {
+                    errors[w] = std::current_exception();
+                }
+            });
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+        for (std::exception_ptr const &error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+    }
+
+    /**
+     * Probe with `n` rows, calling `emit(build_payload, probe_payload)` for
+     * every pair of rows with equal keys.
+     *
+     * # Returns
+     * The number of matches
+     */
+    template <typename F> size_t probe(Key const *keys, Payload const *payloads, size_t n, F emit)
+    {
+        if (partitions.empty()) return 0;
+        if (partitions.size() == 1) {
+            return probe_partition(partitions[0], keys, payloads, n, emit);
+        }
+        std::vector<Partition> probe_partitions(partitions.size());
+        partition(keys, payloads, n, probe_partitions);
+        size_t nr_matches = 0;
+        for (size_t p = 0; p < partitions.size(); ++p) {
+            Partition &probe_part = probe_partitions[p];
+            nr_matches += probe_partition(partitions[p], probe_part.keys.data(),
+                                          probe_part.payloads.data(), probe_part.keys.size(),
+                                          emit);
+        }
+        return nr_matches;
+    }
+};
@@ -3,10 +3,14 @@
 #include <stdint.h>
 #include "buf.hpp"
 #include "simd.hpp"
-#include <emmintrin.h>
 #include <limits>
 #include <cstring>
+#include <algorithm>
 #include <bitset>
+#include <type_traits>
+#include <string>
+#include <string_view>
+#include <cassert>
 #include <endian.h>
 
 #if __BYTE_ORDER != __LITTLE_ENDIAN
@@ -28,6 +32,18 @@ template <typename T> struct is_trivially_equatable
     static constexpr bool value = false;
 };
 
+/**
+ * Whether moving a `T` somewhere else and then forgetting the original,
+ * without running its destructor, is just a `memcpy()`. True for anything
+ * trivially copyable. Types that own memory through pointers that don't point
+ * back into themselves (a `std::unique_ptr`, most containers, but not a
+ * `std::string` with its SSO buffer) can opt in too.
+ */
+template <typename T> struct is_trivially_relocatable
+{
+    static constexpr bool value = std::is_trivially_copyable<T>::value;
+};
+
 static_assert(std::numeric_limits<size_t>::digits == 64);
 
 size_t byteshl(size_t n)
@@ -61,32 +77,90 @@ IMPL_HASHABLE_FOR_INTEGRAL(unsigned int);
 IMPL_HASHABLE_FOR_INTEGRAL(long);
 IMPL_HASHABLE_FOR_INTEGRAL(unsigned long);
 
+/**
+ * Hash `len` bytes 8 at a time. Every word gets mixed in, since the table takes
+ * both the home chunk and h7 from the low bits (just xor-ing the words
+ * together makes strings that only differ in a few places collide a lot).
+ */
+inline size_t hash_bytes(char const *data, size_t len)
+{
+    size_t const K = 0x9e3779b97f4a7c15;
+    size_t h = len * K;
+    size_t i = 0;
+    for (; i + sizeof(size_t) <= len; i += sizeof(size_t)) {
+        size_t word;
+        memcpy(&word, data + i, sizeof(size_t));
+        h = (h ^ word) * K;
+        h ^= h >> 29;
+    }
+    if (i < len) {
+        size_t word = 0;
+        memcpy(&word, data + i, len - i);
+        h = (h ^ word) * K;
+    }
+    // Finalize so that the high bits make it down to the low ones
+    h ^= h >> 32;
+    h *= 0xbf58476d1ce4e5b9;
+    h ^= h >> 29;
+    return h;
+}
+
 template <> struct is_hashable<std::string>
 {
     static constexpr bool value = true;
 
     static size_t hash(std::string const &str)
     {
-        static_assert(alignof(max_align_t) > alignof(size_t));
-        // std::string internally uses malloc, so this means we can now rely
-        // on the buffer being size_t-aligned
-        size_t len = str.size() / sizeof(size_t);
-        size_t h = 0;
-        size_t const *it = (size_t *)str.data();
-        for (size_t i = 0; i < len; ++i) {
-            h ^= is_hashable<size_t>::hash(*it);
-            it++;
-        }
-        size_t shift = 0;
-        for (size_t i = len * sizeof(size_t); i < str.size(); ++i) {
-            h ^= is_hashable<size_t>::hash(((size_t)str[i]) << shift);
-            shift += 8;
-        }
-        return h;
+        return hash_bytes(str.data(), str.size());
+    }
+};
+
+/** Hashes the same as the `std::string` with the same bytes */
+template <> struct is_hashable<std::string_view>
+{
+    static constexpr bool value = true;
+
+    static size_t hash(std::string_view const &str)
+    {
+        return hash_bytes(str.data(), str.size());
     }
 };
 
+// Not actually trivial to compare, but this gets `HashTbl` to compare hashes
+// before it goes anywhere near the bytes
+template <> struct is_trivially_equatable<std::string_view>
+{
+    static constexpr bool value = true;
+};
+
+/**
+ * Hash `n` keys into `out`, ahead of a batch of table operations that take
+ * the hashes (`get_batch()`, `insert_batch()`, `upsert_hashed()` and so on).
+ * For the integer types, `is_hashable` is the identity, so this is a widening
+ * copy that the compiler vectorizes; other keys are hashed one at a time.
+ */
+template <typename Key, typename Hasher = is_hashable<Key>>
+inline void hash_batch(Key const *keys, size_t n, size_t *out)
+{
+    static_assert(Hasher::value, "Key must be hashable");
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = Hasher::hash(keys[i]);
+    }
+}
+
+/**
+ * Ctrl chunks are SSE2 vectors of 16 ctrl bytes, unless SSE2 isn't there or
+ * `HASHMAP_SWAR` is defined, in which case they're `uint64_t`s of 8, matched
+ * with bit tricks (see `usimd<uint64_t>`). The rest of the table only goes by
+ * `CtrlChunk::NR_BYTES` and `ctrlmask_t`, so both work the same.
+ */
+#if defined(HASHMAP_SWAR) || !defined(__SSE2__)
+#define HASHMAP_CTRLCHUNK_SWAR 1
+using ctrlchunk_t = uint64_t;
+#else
+#define HASHMAP_CTRLCHUNK_SWAR 0
 using ctrlchunk_t = __m128i;
+#endif
 typedef movemask_t<ctrlchunk_t>::type ctrlmask_t;
 
 /**
@@ -144,6 +218,15 @@ struct alignas(alignof(ctrlchunk_t)) CtrlChunk
         return ~(del_mask | empty_mask);
     }
 
+    /**
+     * Mark every byte in `mask` as empty, in one store.
+     */
+    void set_empty(ctrlmask_t mask)
+    {
+        static_assert(CTRL_EMPTY == -1, "set_empty() relies on CTRL_EMPTY being all ones");
+        *(ctrlchunk_t *)this = simd<ctrlchunk_t>::set_ones(as_simd(), mask);
+    }
+
     inline static ctrlmask_t mask_ctz(ctrlmask_t n)
     {
         return unsigned_int<std::numeric_limits<ctrlmask_t>::digits>::ctz(n);
@@ -161,10 +244,269 @@ size_t inline alignup(size_t n, size_t pow2)
     return (n + mask) & ~mask;
 }
 
-template <typename Key, typename Val> struct HashTbl
+/**
+ * Round `n` up to the nearest power of 2. `0` stays `0`.
+ */
+constexpr size_t nextpow2(size_t n)
+{
+    return n <= 1 ? n : (size_t)1 << (std::numeric_limits<size_t>::digits - __builtin_clzl(n - 1));
+}
+
+/**
+ * Probe policies decide which ctrl chunk `HashTbl::get_slot` looks at next when
+ * the current one can't settle the lookup. A policy is constructed from the
+ * hash, the home ctrl chunk and the number of ctrl chunks, and `next()` yields
+ * the index of the next ctrl chunk to probe.
+ *
+ * Policies with `NEEDS_POW2_CTRLCHUNKS` only visit every ctrl chunk if there
+ * are a power of 2 of them, `HashTbl` rounds its capacity up accordingly.
+ */
+struct LinearProbe
+{
+    static constexpr bool NEEDS_POW2_CTRLCHUNKS = false;
+
+    size_t ctrlchunk_idx;
+    size_t nr_ctrlchunks;
+
+    LinearProbe(size_t, size_t ctrlchunk_idx, size_t nr_ctrlchunks)
+        : ctrlchunk_idx(ctrlchunk_idx)
+        , nr_ctrlchunks(nr_ctrlchunks)
+    {
+    }
+
+    size_t next()
+    {
+        ctrlchunk_idx = (ctrlchunk_idx + 1) % nr_ctrlchunks;
+        return ctrlchunk_idx;
+    }
+};
+
+/**
+ * Quadratic probing over ctrl chunks, with strides 1, 2, 3... so we visit
+ * the triangular numbers. Breaks up the long runs of full chunks that linear
+ * probing builds with clustered keys.
+ */
+struct TriangularProbe
+{
+    static constexpr bool NEEDS_POW2_CTRLCHUNKS = true;
+
+    size_t ctrlchunk_idx;
+    size_t mask;
+    size_t stride;
+
+    TriangularProbe(size_t, size_t ctrlchunk_idx, size_t nr_ctrlchunks)
+        : ctrlchunk_idx(ctrlchunk_idx)
+        , mask(nr_ctrlchunks - 1)
+        , stride(0)
+    {
+    }
+
+    size_t next()
+    {
+        stride++;
+        ctrlchunk_idx = (ctrlchunk_idx + stride) & mask;
+        return ctrlchunk_idx;
+    }
+};
+
+/**
+ * Double hashing over ctrl chunks. The stride comes from the high bits of a
+ * fibonacci-multiplied hash (so it is independent of the home chunk, which
+ * comes from the low bits) and is forced odd, so it is coprime with the power
+ * of 2 number of ctrl chunks.
+ */
+struct DoubleHashProbe
+{
+    static constexpr bool NEEDS_POW2_CTRLCHUNKS = true;
+
+    size_t ctrlchunk_idx;
+    size_t mask;
+    size_t stride;
+
+    DoubleHashProbe(size_t h, size_t ctrlchunk_idx, size_t nr_ctrlchunks)
+        : ctrlchunk_idx(ctrlchunk_idx)
+        , mask(nr_ctrlchunks - 1)
+        , stride(((h * 0x9e3779b97f4a7c15) >> 32) | 1)
+    {
+    }
+
+    size_t next()
+    {
+        ctrlchunk_idx = (ctrlchunk_idx + stride) & mask;
+        return ctrlchunk_idx;
+    }
+};
+
+/**
+ * Layout policies decide where the ctrl chunks and entries live inside the
+ * table's buffer. All functions take the start of the region they manage and
+ * the number of ctrl chunks in the table.
+ *
+ * `SplitLayout` keeps all ctrl chunks together, followed by all entries:
+ *
+ * +--------------------+
+ * | ctrl chunks        |
+ * +--------------------+
+ * | entries            |
+ * +--------------------+
+ *
+ * so probing only ever touches the (small, dense) ctrl region until we get a
+ * tag hit.
+ */
+struct SplitLayout
+{
+    /** Whether ctrl chunk `i + 1` directly follows ctrl chunk `i` */
+    static const bool CONTIGUOUS_CTRLCHUNKS = true;
+
+    template <typename Entry> static size_t entries_offset(size_t nr_ctrlchunks)
+    {
+        return alignup(nr_ctrlchunks * sizeof(CtrlChunk), alignof(Entry));
+    }
+
+    template <typename Entry> static size_t buf_size(size_t nr_ctrlchunks)
+    {
+        return entries_offset<Entry>(nr_ctrlchunks) +
+               nr_ctrlchunks * CtrlChunk::NR_BYTES * sizeof(Entry);
+    }
+
+    template <typename Entry>
+    static CtrlChunk *ctrlchunk_at(uint8_t *buf, size_t, size_t ctrlchunk_idx)
+    {
+        return (CtrlChunk *)buf + ctrlchunk_idx;
+    }
+
+    template <typename Entry> static Entry *entry_at(uint8_t *buf, size_t nr_ctrlchunks, size_t idx)
+    {
+        return (Entry *)(buf + entries_offset<Entry>(nr_ctrlchunks)) + idx;
+    }
+
+    template <typename Entry>
+    static size_t ctrlchunk_idx_of(uint8_t const *buf, size_t, char const *ctrl_byte)
+    {
+        return (size_t)((uint8_t const *)ctrl_byte - buf) / sizeof(CtrlChunk);
+    }
+
+    /**
+     * Move the ctrl chunks and entries of a region laid out for
+     * `old_nr_ctrlchunks` at `old_buf` to where they go in one for
+     * `new_nr_ctrlchunks` at `new_buf`, within the same (big enough) buffer.
+     * `new_buf` can't be before `old_buf`, so everything moves up and we go
+     * from the end.
+     */
+    template <typename Entry>
+    static void relocate(uint8_t *old_buf, size_t old_nr_ctrlchunks, uint8_t *new_buf,
+                         size_t new_nr_ctrlchunks)
+    {
+        memmove(entry_at<Entry>(new_buf, new_nr_ctrlchunks, 0),
+                entry_at<Entry>(old_buf, old_nr_ctrlchunks, 0),
+                old_nr_ctrlchunks * CtrlChunk::NR_BYTES * sizeof(Entry));
+        memmove(new_buf, old_buf, old_nr_ctrlchunks * sizeof(CtrlChunk));
+    }
+};
+
+/**
+ * `InterleavedLayout` stores each ctrl chunk right in front of the entries it
+ * describes:
+ *
+ * +------+-------------+------+-------------+-----
+ * | ctrl | 16 entries  | ctrl | 16 entries  | ...
+ * +------+-------------+------+-------------+-----
+ *
+ * so a successful lookup in a big table touches one page (and usually one
+ * prefetch stream) rather than two.
+ */
+struct InterleavedLayout
+{
+    static const bool CONTIGUOUS_CTRLCHUNKS = false;
+
+    template <typename Entry> static size_t entries_offset()
+    {
+        return alignup(sizeof(CtrlChunk), alignof(Entry));
+    }
+
+    template <typename Entry> static size_t group_size()
+    {
+        return alignup(entries_offset<Entry>() + CtrlChunk::NR_BYTES * sizeof(Entry),
+                       alignof(CtrlChunk) > alignof(Entry) ? alignof(CtrlChunk) : alignof(Entry));
+    }
+
+    template <typename Entry> static size_t buf_size(size_t nr_ctrlchunks)
+    {
+        return nr_ctrlchunks * group_size<Entry>();
+    }
+
+    template <typename Entry>
+    static CtrlChunk *ctrlchunk_at(uint8_t *buf, size_t, size_t ctrlchunk_idx)
+    {
+        return (CtrlChunk *)(buf + ctrlchunk_idx * group_size<Entry>());
+    }
+
+    template <typename Entry> static Entry *entry_at(uint8_t *buf, size_t, size_t idx)
+    {
+        uint8_t *group = buf + idx / CtrlChunk::NR_BYTES * group_size<Entry>();
+        return (Entry *)(group + entries_offset<Entry>()) + idx % CtrlChunk::NR_BYTES;
+    }
+
+    template <typename Entry>
+    static size_t ctrlchunk_idx_of(uint8_t const *buf, size_t, char const *ctrl_byte)
+    {
+        return (size_t)((uint8_t const *)ctrl_byte - buf) / group_size<Entry>();
+    }
+
+    /** See `SplitLayout::relocate()`, groups don't depend on the chunk count */
+    template <typename Entry>
+    static void relocate(uint8_t *old_buf, size_t old_nr_ctrlchunks, uint8_t *new_buf, size_t)
+    {
+        memmove(new_buf, old_buf, old_nr_ctrlchunks * group_size<Entry>());
+    }
+};
+
+/**
+ * Growth policies decide how `HashTbl::grow()` makes room: by what factor it
+ * grows, and whether it can do so in place.
+ *
+ * `CopyGrowth` quadruples into a freshly allocated buffer and moves every
+ * entry across, so for a moment both buffers are live, 5x the old one.
+ */
+struct CopyGrowth
+{
+    static const size_t FACTOR = 4;
+    static const bool IN_PLACE = false;
+};
+
+/**
+ * `InPlaceGrowth` doubles the buffer with `realloc()`, which for the big
+ * tables where this matters is an `mremap()` that doesn't copy, and then
+ * moves the entries to their new homes within it. Peak memory is the new
+ * buffer, 2x the old one. The entries are moved with `memcpy()`, so they have
+ * to be trivially relocatable.
+ */
+struct InPlaceGrowth
+{
+    static const size_t FACTOR = 2;
+    static const bool IN_PLACE = true;
+};
+
+/**
+ * `Hasher` is where the table gets `hash(key)` from, `is_hashable<Key>` unless
+ * the keys need something else. A table only calls it from the operations
+ * that take a bare key (`insert()`, `get()`...) and from the `NDEBUG`-less
+ * checks in the `_hashed` ones, since entries carry their hash.
+ */
+template <typename Key, typename Val, typename Probe = LinearProbe, typename SlotLayout = SplitLayout,
+          typename Growth = CopyGrowth, typename Hasher = is_hashable<Key>>
+struct HashTbl
 {
-    static_assert(is_hashable<Key>::value, "Key must be hashable");
-    using Self = HashTbl<Key, Val>;
+    static_assert(Hasher::value, "Key must be hashable");
+    using Self = HashTbl<Key, Val, Probe, SlotLayout, Growth, Hasher>;
+
+    // Wrappers that place and drop entries themselves. They go through
+    // `claim_empty_slot()` and `release_slot()`, which keep the size,
+    // occupancy bitmap and overflow counts in step, but nobody else should.
+    template <typename, typename> friend class HashCache;
+    template <typename, typename> friend class ExpiringTbl;
+    template <typename> friend class StrTbl;
+    friend class StringInterner;
 
 public:
     struct Entry
@@ -209,12 +551,33 @@ public:
         ~Entry() = default;
     };
 
+    /** Whether entries can be moved with a `memcpy()`, see `is_trivially_relocatable` */
+    static constexpr bool RELOCATABLE =
+        is_trivially_relocatable<Key>::value && is_trivially_relocatable<Val>::value;
+
+    static_assert(!Growth::IN_PLACE || RELOCATABLE,
+                  "InPlaceGrowth moves entries with memcpy(), so they must be trivially relocatable");
+
+    /**
+     * Move the entry at `src` into the uninitialized `dst`, leaving `src`
+     * uninitialized (so not to be destructed) too.
+     */
+    static void relocate_entry(Entry *dst, Entry *src)
+    {
+        if (RELOCATABLE) {
+            memcpy((void *)dst, (void *)src, sizeof(Entry));
+        } else {
+            new (dst) Entry(std::move(*src));
+            src->~Entry();
+        }
+    }
+
     struct Iter
     {
     private:
         size_t ctrlchunk_idx;
         ctrlmask_t present_mask;
-        HashTbl<Key, Val> const &tbl;
+        Self const &tbl;
 
         size_t idx()
         {
@@ -222,19 +585,17 @@ public:
         }
 
     public:
-        Iter(HashTbl<Key, Val> const &tbl)
+        Iter(Self const &tbl)
             : tbl(tbl)
         {
         }
 
         Iter &begin()
         {
-            ctrlchunk_idx = 0;
-            if (tbl.max_nr_entries == 0) {
-                present_mask = 0;
-            } else {
-                present_mask = tbl.ctrlchunks_buf()->present_mask();
-                find_next_present();
+            ctrlchunk_idx = tbl.next_occupied_ctrlchunk(0);
+            present_mask = 0;
+            if (*this != tbl.end()) {
+                present_mask = tbl.ctrlchunk_at(ctrlchunk_idx)->present_mask();
             }
             return *this;
         }
@@ -250,12 +611,14 @@ public:
             if (*this == tbl.end()) {
                 return false;
             }
-            while (!present_mask) {
-                ctrlchunk_idx++;
+            if (!present_mask) {
+                // The occupancy bitmap lets us skip straight over runs of
+                // empty ctrl chunks
+                ctrlchunk_idx = tbl.next_occupied_ctrlchunk(ctrlchunk_idx + 1);
                 if (*this == tbl.end()) {
                     return false;
                 }
-                present_mask = tbl.ctrlchunks_buf()[ctrlchunk_idx].present_mask();
+                present_mask = tbl.ctrlchunk_at(ctrlchunk_idx)->present_mask();
             }
             return true;
         }
@@ -271,7 +634,7 @@ public:
 
         std::pair<Key const &, Val &> operator*()
         {
-            Entry *e = tbl.entries_buf() + idx();
+            Entry *e = tbl.entry_at(idx());
             return std::pair<Key const &, Val &>(e->key, e->val);
         }
 
@@ -291,16 +654,103 @@ public:
          */
         void read(Entry *dst)
         {
-            memcpy(dst, tbl.entries_buf() + idx(), sizeof(Entry));
+            memcpy(dst, tbl.entry_at(idx()), sizeof(Entry));
+        }
+    };
+
+    /**
+     * Owns an `Entry` that was `extract()`-ed from a table, cached hash and
+     * all, so that it can be `insert()`-ed into another table without
+     * rehashing or constructing the key and value again.
+     */
+    struct NodeHandle
+    {
+    private:
+        friend Self;
+
+        typename std::aligned_storage<sizeof(Entry), alignof(Entry)>::type entry_mu;
+        bool present;
+
+        Entry &entry()
+        {
+            return reinterpret_cast<Entry &>(entry_mu);
+        }
+
+    public:
+        NodeHandle()
+            : present(false)
+        {
+        }
+
+        NodeHandle(NodeHandle const &) = delete;
+
+        NodeHandle &operator=(NodeHandle const &) = delete;
+
+        NodeHandle(NodeHandle &&other) noexcept
+            : present(other.present)
+        {
+            if (present) {
+                relocate_entry(&entry(), &other.entry());
+                other.present = false;
+            }
+        }
+
+        NodeHandle &operator=(NodeHandle &&other) noexcept
+        {
+            if (this != &other) {
+                clear();
+                if (other.present) {
+                    relocate_entry(&entry(), &other.entry());
+                    present = true;
+                    other.present = false;
+                }
+            }
+            return *this;
+        }
+
+        ~NodeHandle()
+        {
+            clear();
+        }
+
+        void clear()
+        {
+            if (present) entry().~Entry();
+            present = false;
+        }
+
+        bool empty() const
+        {
+            return !present;
+        }
+
+        size_t hash()
+        {
+            return entry().hash;
+        }
+
+        Key const &key()
+        {
+            return entry().key;
+        }
+
+        Val &val()
+        {
+            return entry().val;
         }
     };
 
 private:
     /*
     +-----------+
-    | ctrl      |
+    | occupancy |
+    +-----------+
+    | overflow  |
     +-----------+
-    | entries   |
+    | ctrl and  |
+    | entries,  |
+    | see       |
+    | SlotLayout|
     +-----------+
     */
     uint8_t *buf;
@@ -308,14 +758,17 @@ private:
     /** used to calculate load factor */
     size_t nr_used;
 
-    static const size_t BUF_ALIGNMENT = alignof(ctrlchunk_t);
+    static const size_t BUF_ALIGNMENT =
+        alignof(ctrlchunk_t) > alignof(Entry) ? alignof(ctrlchunk_t) : alignof(Entry);
+    /** Overflow counts stick once they get here, we can't know when to decrement */
+    static const uint8_t OVERFLOW_SATURATED = std::numeric_limits<uint8_t>::max();
 
-    char h7(size_t hash)
+    char h7(size_t hash) const
     {
         return (char)(hash & 0b1111111);
     }
 
-    bool cmp_keys(size_t hash, Key const &key, size_t other_hash, Key const &other_key)
+    bool cmp_keys(size_t hash, Key const &key, size_t other_hash, Key const &other_key) const
     {
         // should just optimize away
         if (is_trivially_equatable<Key>::value) {
@@ -325,6 +778,113 @@ private:
         }
     }
 
+    /**
+     * The `_hashed` operations trust the caller's hash. A wrong one doesn't
+     * fail, it just sends the key to the wrong chunk (and, for trivially
+     * equatable keys, fails every compare), so we check it unless `NDEBUG`.
+     */
+    void check_hash(size_t h, Key const &key) const
+    {
+        assert(h == Hasher::hash(key) && "wrong hash passed to a _hashed operation");
+        (void)h;
+        (void)key;
+    }
+
+    /** Go up from `capacity` in `grow()`'s steps until `nr_entries` fit */
+    static size_t grown_capacity(size_t capacity, size_t nr_entries)
+    {
+        while (nr_entries >= capacity / 4 * 3) {
+            capacity *= Growth::FACTOR;
+        }
+        return capacity;
+    }
+
+    /** `capacity` rounded up to what a buffer can actually hold */
+    static size_t rounded_capacity(size_t capacity)
+    {
+        size_t rounded = alignup(capacity, CtrlChunk::NR_BYTES);
+        if (Probe::NEEDS_POW2_CTRLCHUNKS) {
+            rounded = nextpow2(rounded / CtrlChunk::NR_BYTES) * CtrlChunk::NR_BYTES;
+        }
+        return rounded;
+    }
+
+    /**
+     * `rebuild()` to a bigger `capacity` (already rounded) without a second
+     * buffer: extend this one, slide the ctrl chunks and entries up to where
+     * the bigger layout has them, then put every entry back through
+     * `claim_empty_slot()`.
+     *
+     * The old entries are marked with `CTRL_DEL` first, which no lookup or
+     * insert treats as empty, so they never get overwritten before we get to
+     * them. A chunk still full of them can make an entry land further along
+     * than it would in a fresh table, but the overflow counts on the way are
+     * bumped as for any insert, so lookups and removes stay exact.
+     */
+    void grow_in_place(size_t capacity)
+    {
+        size_t old_nr_ctrlchunks = nr_ctrlchunks();
+        size_t old_meta_size = meta_buf_size();
+        size_t old_size = buf_size();
+        size_t old_max_nr_entries = max_nr_entries;
+        max_nr_entries = capacity;
+        size_t meta_size = meta_buf_size();
+        size_t size = buf_size();
+        max_nr_entries = old_max_nr_entries;
+
+        FlatBuf flat;
+        flat.data = buf;
+        flat.grow(Layout(old_size, BUF_ALIGNMENT), Layout(size, BUF_ALIGNMENT));
+        buf = flat.data;
+        max_nr_entries = capacity;
+
+        SlotLayout::template relocate<Entry>(buf + old_meta_size, old_nr_ctrlchunks, buf + meta_size,
+                                         nr_ctrlchunks());
+        memset(buf, 0, meta_size);
+        for (size_t i = old_nr_ctrlchunks; i < nr_ctrlchunks(); ++i) {
+            memset(ctrlchunk_at(i), CtrlChunk::CTRL_EMPTY, sizeof(CtrlChunk));
+        }
+        for (size_t i = 0; i < old_nr_ctrlchunks; ++i) {
+            CtrlChunk *ctrlchunk = ctrlchunk_at(i);
+            for (size_t j = 0; j < CtrlChunk::NR_BYTES; ++j) {
+                if (ctrlchunk->bytes[j] != CtrlChunk::CTRL_EMPTY) {
+                    ctrlchunk->bytes[j] = CtrlChunk::CTRL_DEL;
+                }
+            }
+        }
+
+        nr_used = 0;
+        alignas(Entry) unsigned char moving[sizeof(Entry)];
+        for (size_t i = 0; i < old_nr_ctrlchunks; ++i) {
+            CtrlChunk *ctrlchunk = ctrlchunk_at(i);
+            ctrlmask_t pending =
+                simd<ctrlchunk_t>::movemask_eq(ctrlchunk->as_simd(), CtrlChunk::CTRL_DEL);
+            while (pending) {
+                size_t offset = CtrlChunk::mask_ctz(pending);
+                pending &= pending - 1;
+                // Free the slot first, the entry might well end up right back
+                // in it
+                relocate_entry((Entry *)moving, entry_at(i * CtrlChunk::NR_BYTES + offset));
+                ctrlchunk->bytes[offset] = CtrlChunk::CTRL_EMPTY;
+                relocate_entry(claim_empty_slot(((Entry *)moving)->hash), (Entry *)moving);
+            }
+        }
+    }
+
+    /** Destruct every entry and go back to having no buffer, like a new table */
+    void free_buf()
+    {
+        if (!buf) return;
+        for (auto kv : *this) {
+            const_cast<Key &>(kv.first).~Key();
+            kv.second.~Val();
+        }
+        free(buf);
+        buf = nullptr;
+        max_nr_entries = 0;
+        nr_used = 0;
+    }
+
     template <int COUNT> void prefetch_entries(Entry *e, ctrlmask_t mask)
     {
         for (int i = 0; i < COUNT; ++i) {
@@ -364,25 +924,20 @@ public:
     static Self with_capacity(size_t capacity)
     {
         auto self = Self();
-        // alignup
-        self.max_nr_entries = alignup(capacity, CtrlChunk::NR_BYTES);
+        self.max_nr_entries = rounded_capacity(capacity);
         if (posix_memalign((void **)&self.buf, BUF_ALIGNMENT, self.buf_size())) {
             throw std::runtime_error("OOM");
         }
-        memset(self.buf, CtrlChunk::CTRL_EMPTY, self.max_nr_entries);
+        memset(self.buf, 0, self.meta_buf_size());
+        for (size_t i = 0; i < self.nr_ctrlchunks(); ++i) {
+            memset(self.ctrlchunk_at(i), CtrlChunk::CTRL_EMPTY, sizeof(CtrlChunk));
+        }
         return self;
     }
 
     ~HashTbl()
     {
-        if (buf) {
-            for (auto kv : *this) {
-                const_cast<Key &>(kv.first).~Key();
-                kv.second.~Val();
-            }
-            free(buf);
-            buf = nullptr;
-        }
+        free_buf();
     }
 
     HashTbl(HashTbl &)
@@ -406,19 +961,33 @@ public:
         return *this;
     }
 
-    size_t ctrlchunk_buf_size() const
+    size_t nr_ctrlchunks() const
+    {
+        return max_nr_entries / CtrlChunk::NR_BYTES;
+    }
+
+    size_t nr_occupancy_words() const
+    {
+        return alignup(nr_ctrlchunks(), 64) / 64;
+    }
+
+    /**
+     * The size of the occupancy bitmap and overflow counts, padded so that the
+     * ctrl chunks and entries that follow are aligned.
+     */
+    size_t meta_buf_size() const
     {
-        // We need to make this assumption for our calculation to make sense --
-        // that the byte directly after our ctrl chunks is ctrlchunk_t-aligned.
-        // alignof(ctrlchunk_t) == sizeof(ctrlchunk_t)
-        size_t padding_sz =
-            alignof(ctrlchunk_t) > alignof(Entry) ? 0 : alignof(Entry) - alignof(ctrlchunk_t);
-        return sizeof(ctrlchunk_t) * max_nr_entries + padding_sz;
+        return alignup(nr_occupancy_words() * sizeof(uint64_t) + nr_ctrlchunks(), BUF_ALIGNMENT);
     }
 
     size_t buf_size() const
     {
-        return ctrlchunk_buf_size() + sizeof(Entry) * max_nr_entries;
+        return meta_buf_size() + SlotLayout::template buf_size<Entry>(nr_ctrlchunks());
+    }
+
+    size_t size() const
+    {
+        return nr_used;
     }
 
     Iter begin() const
@@ -435,44 +1004,222 @@ public:
 
     void grow()
     {
-        auto newtbl =
-            Self::with_capacity(max_nr_entries ? max_nr_entries * 4 : CtrlChunk::NR_BYTES * 4);
-        for (auto it = begin(); it != end(); ++it) {
-            // This is probably a C++ anti-pattern, but I come from Rust-land
-            // Where it is also an anti-pattern, but ermm.... whatever?
-            //
-            // We want to move the `Entry` out of the old thing, but we don't
-            // need to do a copy-and-swap move-assignment, so we just do a
-            // memcpy and then a move ctor for both Key and Val.
-            //
-            // TODO: I will be shocked if there is a genuine need for this mess.
-            // Fix this at some point.
-            using ManuallyDropEntry =
-                typename std::aligned_storage<sizeof(Entry), alignof(Entry)>::type;
-            ManuallyDropEntry e_mu;
-            it.read((Entry *)&e_mu);
-            Entry &e = reinterpret_cast<Entry &>(static_cast<ManuallyDropEntry &>(e_mu));
-            // TODO: we can save a bit of time by not rehashing
-            newtbl.insert(std::move(e.key), std::move(e.val));
-        }
-        free(buf);
-        buf = newtbl.buf;
-        newtbl.buf = nullptr;
-        max_nr_entries = newtbl.max_nr_entries;
-        nr_used = newtbl.nr_used;
+        rebuild(max_nr_entries ? max_nr_entries * Growth::FACTOR : CtrlChunk::NR_BYTES * 4);
     }
 
-    CtrlChunk *ctrlchunks_buf() const
+    /**
+     * The capacity that repeatedly `grow()`-ing would end up at to hold
+     * `nr_entries`. We stick to the same steps rather than sizing to fit
+     * exactly, since the identity hash maps dense key ranges into clusters
+     * when the table is only just big enough.
+     */
+    size_t capacity_for(size_t nr_entries) const
     {
-        return (CtrlChunk *)buf;
+        return grown_capacity(max_nr_entries ? max_nr_entries : CtrlChunk::NR_BYTES * 4,
+                              nr_entries);
     }
 
-    Entry *entries_buf() const
+    /**
+     * Make room for `nr_entries` in total, so that inserting up to that many
+     * grows (at most) once, here, rather than every 4x on the way.
+     */
+    void reserve(size_t nr_entries)
     {
-        return (Entry *)(buf + ctrlchunk_buf_size());
+        size_t capacity = capacity_for(nr_entries);
+        if (capacity != max_nr_entries) rebuild(capacity);
     }
 
-    void insert_unchecked(size_t idx, Entry e)
+    /**
+     * Rebuild with room for at least `capacity` entries, or for the ones we
+     * have if that needs more. Unlike `reserve()` this can shrink the table,
+     * and `capacity` is rounded up to a power of 2 rather than the `grow()`
+     * steps. An empty table rehashed to 0 gives its buffer back altogether.
+     * Like any rebuild, this moves every entry, so pointers into the table
+     * don't survive it.
+     */
+    void rehash(size_t capacity)
+    {
+        if (nr_used == 0 && capacity == 0) {
+            free_buf();
+            return;
+        }
+        size_t needed = grown_capacity(CtrlChunk::NR_BYTES * 4, nr_used);
+        capacity = std::max(needed, nextpow2(std::max(capacity, (size_t)CtrlChunk::NR_BYTES)));
+        if (capacity != max_nr_entries) rebuild(capacity);
+    }
+
+    /**
+     * Shrink to the capacity that `grow()`-ing from empty would have reached
+     * for the entries we have, e.g. after removing most of them.
+     */
+    void shrink_to_fit()
+    {
+        rehash(0);
+    }
+
+    /**
+     * Move every entry into a fresh buffer with room for `capacity` entries
+     * (or, with `InPlaceGrowth` and a bigger `capacity`, into this buffer
+     * made bigger).
+     */
+    void rebuild(size_t capacity)
+    {
+        if (Growth::IN_PLACE && buf && rounded_capacity(capacity) > max_nr_entries) {
+            grow_in_place(rounded_capacity(capacity));
+            return;
+        }
+        auto newtbl = Self::with_capacity(capacity);
+        // Entries are relocated into their new slots: a memcpy if they're
+        // trivially relocatable, otherwise (std::string's SSO buffer points
+        // into itself, for one) move-constructed and then destructed. They're
+        // already unique and carry their hash, so there's no need to rehash or
+        // look for existing keys.
+        //
+        // The ctrl chunks go in blocks of 64 (one occupancy word), which a
+        // wide SIMD kernel can turn into present masks in one go when they're
+        // contiguous.
+        ctrlmask_t present_masks[64];
+        for (size_t word_idx = 0; word_idx < nr_occupancy_words(); ++word_idx) {
+            uint64_t occupied = occupancy_buf()[word_idx];
+            if (!occupied) continue;
+            size_t first_ctrlchunk_idx = word_idx * 64;
+            bool use_kernels = SlotLayout::CONTIGUOUS_CTRLCHUNKS && !HASHMAP_CTRLCHUNK_SWAR;
+#if !HASHMAP_CTRLCHUNK_SWAR
+            if (use_kernels) {
+                size_t nr_block = std::min((size_t)64, nr_ctrlchunks() - first_ctrlchunk_idx);
+                simd_kernels().present_chunks(ctrlchunk_at(first_ctrlchunk_idx)->bytes, nr_block,
+                                              present_masks);
+            }
+#endif
+            while (occupied) {
+                size_t offset = __builtin_ctzll(occupied);
+                occupied &= occupied - 1;
+                size_t ctrlchunk_idx = first_ctrlchunk_idx + offset;
+                ctrlmask_t present_mask = use_kernels ? present_masks[offset]
+                                                      : ctrlchunk_at(ctrlchunk_idx)->present_mask();
+                while (present_mask) {
+                    size_t i =
+                        ctrlchunk_idx * CtrlChunk::NR_BYTES + CtrlChunk::mask_ctz(present_mask);
+                    present_mask &= present_mask - 1;
+                    Entry *e = entry_at(i);
+                    relocate_entry(newtbl.claim_empty_slot(e->hash), e);
+                }
+            }
+        }
+        free(buf);
+        buf = newtbl.buf;
+        newtbl.buf = nullptr;
+        max_nr_entries = newtbl.max_nr_entries;
+        nr_used = newtbl.nr_used;
+    }
+
+private:
+    /**
+     * One count per ctrl chunk of how many entries had to be placed further
+     * along their probe sequence because this chunk was full (F14-style). A
+     * lookup can stop as soon as it has looked at a chunk with a count of 0.
+     */
+    uint8_t *overflows_buf() const
+    {
+        return buf + nr_occupancy_words() * sizeof(uint64_t);
+    }
+
+    /**
+     * One bit per ctrl chunk, set if that chunk has any entries in it. Lets
+     * iteration skip empty chunks 64 at a time, so it costs in proportion to
+     * the live entries rather than the capacity.
+     */
+    uint64_t *occupancy_buf() const
+    {
+        return (uint64_t *)buf;
+    }
+
+    /**
+     * The index of the first ctrl chunk at or after `ctrlchunk_idx` that has
+     * any entries in it, or `nr_ctrlchunks()` if there are none.
+     */
+    size_t next_occupied_ctrlchunk(size_t ctrlchunk_idx) const
+    {
+        return next_occupied_ctrlchunk(ctrlchunk_idx, nr_ctrlchunks());
+    }
+
+    /**
+     * Same, but give up (and return `end`) at `end` rather than scanning the
+     * rest of the bitmap.
+     */
+    size_t next_occupied_ctrlchunk(size_t ctrlchunk_idx, size_t end) const
+    {
+        size_t word_idx = ctrlchunk_idx / 64;
+        size_t end_word_idx = alignup(end, 64) / 64;
+        if (word_idx >= end_word_idx) return end;
+        uint64_t word = occupancy_buf()[word_idx] & (~(uint64_t)0 << (ctrlchunk_idx % 64));
+        while (!word) {
+            if (++word_idx == end_word_idx) return end;
+            word = occupancy_buf()[word_idx];
+        }
+        size_t found = word_idx * 64 + __builtin_ctzll(word);
+        return found < end ? found : end;
+    }
+
+    void mark_occupied(size_t ctrlchunk_idx)
+    {
+        occupancy_buf()[ctrlchunk_idx / 64] |= (uint64_t)1 << (ctrlchunk_idx % 64);
+    }
+
+    /**
+     * Clear the occupancy bit for `ctrlchunk_idx` if the chunk has just become
+     * empty.
+     */
+    void update_occupancy(size_t ctrlchunk_idx)
+    {
+        if (ctrlchunk_at(ctrlchunk_idx)->present_mask()) return;
+        occupancy_buf()[ctrlchunk_idx / 64] &= ~((uint64_t)1 << (ctrlchunk_idx % 64));
+    }
+
+    CtrlChunk *ctrlchunk_at(size_t ctrlchunk_idx) const
+    {
+        return SlotLayout::template ctrlchunk_at<Entry>(buf + meta_buf_size(), nr_ctrlchunks(),
+                                                    ctrlchunk_idx);
+    }
+
+    Entry *entry_at(size_t idx) const
+    {
+        return SlotLayout::template entry_at<Entry>(buf + meta_buf_size(), nr_ctrlchunks(), idx);
+    }
+
+    size_t ctrlchunk_idx_of(char const *ctrl_byte) const
+    {
+        return SlotLayout::template ctrlchunk_idx_of<Entry>(buf + meta_buf_size(),
+                                                        nr_ctrlchunks(), ctrl_byte);
+    }
+
+    /**
+     * The ctrl chunk that the probe sequence for `h` starts at.
+     *
+     * Tables that only ever `grow()` have a power of 2 capacity, where the
+     * modulo is just a mask. Checking for that (a predictable branch) is a
+     * lot cheaper than the 64-bit divide that `%` compiles to otherwise.
+     */
+    size_t home_ctrlchunk_idx(size_t h) const
+    {
+        size_t slot_mask = max_nr_entries - 1;
+        if ((max_nr_entries & slot_mask) == 0) return (h & slot_mask) / CtrlChunk::NR_BYTES;
+        return h % max_nr_entries / CtrlChunk::NR_BYTES;
+    }
+
+    /**
+     * The index of the slot whose ctrl byte is `ctrl_slot`, i.e. what
+     * `entry_at()` takes.
+     */
+    size_t slot_idx_of(char const *ctrl_slot) const
+    {
+        size_t ctrlchunk_idx = ctrlchunk_idx_of(ctrl_slot);
+        return ctrlchunk_idx * CtrlChunk::NR_BYTES +
+               (size_t)(ctrl_slot - (char const *)ctrlchunk_at(ctrlchunk_idx));
+    }
+
+public:
+    void insert_unchecked(size_t idx, Entry e)
     {
         throw std::runtime_error("nye");
     }
@@ -484,92 +1231,159 @@ public:
     }
 
     /**
-     * Get the slot where we can insert something with the provided `key`. 
-     * 
+     * Find the slot holding `key`.
+     *
      * # Returns
-     * - `true` if the slot is empty
-     * - `false` if it is occupied
+     * - `true` if the key is not present
+     * - `false` if it is, and then `slot` and `ctrl_slot` point at its entry
+     *   and ctrl byte
      */
     bool get_slot(size_t h, Key const &key, Entry *&slot, char *&ctrl_slot)
     {
-        if (needs_to_grow()) grow();
-
-        Entry *entries = entries_buf();
-        CtrlChunk *ctrlchunks = ctrlchunks_buf();
-
-        // Just memoize some stuff for readability mostly
-        size_t entry_idx = h % max_nr_entries;
-        size_t ctrlchunk_idx = entry_idx / CtrlChunk::NR_BYTES;
-        size_t ctrlbyte_offset = entry_idx % CtrlChunk::NR_BYTES;
-        size_t aligned_entry_idx = ctrlchunk_idx * CtrlChunk::NR_BYTES;
-
-        CtrlChunk ctrlchunk = *(ctrlchunks + ctrlchunk_idx);
+        return get_slot_with(
+            h, [this, h, &key](Entry const &e) { return cmp_keys(h, key, e.hash, e.key); }, slot,
+            ctrl_slot);
+    }
 
-        ctrlmask_t keep_mask = std::numeric_limits<ctrlmask_t>::max() << ctrlbyte_offset;
-        ctrlmask_t hit_mask = simd<ctrlchunk_t>::movemask_eq(ctrlchunk.as_simd(), h7(h)) &
-                              keep_mask;
-        ctrlmask_t empty_mask =
-            simd<ctrlchunk_t>::movemask_eq(ctrlchunk.as_simd(), CtrlChunk::CTRL_EMPTY) & keep_mask;
+    bool get_slot(size_t h, Key const &key, Entry const *&slot, char const *&ctrl_slot) const
+    {
+        Entry *found_slot = nullptr;
+        char *found_ctrl_slot = nullptr;
+        bool empty = get_slot_with(
+            h, [this, h, &key](Entry const &e) { return cmp_keys(h, key, e.hash, e.key); },
+            found_slot, found_ctrl_slot);
+        slot = found_slot;
+        ctrl_slot = found_ctrl_slot;
+        return empty;
+    }
 
-        auto empty_mask_tz = CtrlChunk::mask_ctz(empty_mask);
-        auto hit_mask_tz = CtrlChunk::mask_ctz(hit_mask);
-        while (true) {
-            // Path distribution for 8,388,608 (2^23) randint insertions.
-            // We do on average 1.04 loops... so probably best to just consider
-            // the whole thing as one block of code.
-            // Bad profiling -- the randints are only like 65k so ofc we will
-            // get lots of hits
-            // PATH_AA = 8427816 = %
-            // PATH_AB = 8126464 = %
-            // PATH_B  = 262144  = %
-            // PATH_C  = 39559   = %
-            if (hit_mask_tz < empty_mask_tz) {
+private:
+    /**
+     * `get_slot()`, but with `eq(entry)` deciding whether an entry with a
+     * matching h7 holds the key we're after. For keys that can't be compared
+     * with `==` on their own, e.g. because their bytes live somewhere else.
+     */
+    template <typename Eq> bool get_slot_with(size_t h, Eq eq, Entry *&slot, char *&ctrl_slot) const
+    {
+        if (max_nr_entries == 0) return true;
+
+        uint8_t *overflows = overflows_buf();
+
+        size_t ctrlchunk_idx = home_ctrlchunk_idx(h);
+        Probe probe(h, ctrlchunk_idx, nr_ctrlchunks());
+        // Every probe policy visits each ctrl chunk within its first
+        // `nr_ctrlchunks()` steps, so if we get that far the key isn't here
+        // (only really possible once a lot of overflow counts are saturated)
+        for (size_t nr_probed = 0; nr_probed < nr_ctrlchunks(); ++nr_probed) {
+            CtrlChunk *ctrlchunk = ctrlchunk_at(ctrlchunk_idx);
+            size_t aligned_entry_idx = ctrlchunk_idx * CtrlChunk::NR_BYTES;
+            ctrlmask_t hit_mask = simd<ctrlchunk_t>::movemask_eq(ctrlchunk->as_simd(), h7(h));
+            while (hit_mask) {
 #if MEASURE_PATHS
                 PATH_AA++;
 #endif
                 // We have some kind of hit that we need to check is a complete hit
-                ctrlbyte_offset = hit_mask_tz;
-                size_t i = aligned_entry_idx + ctrlbyte_offset;
-                Entry *entry = entries + i;
-                if (cmp_keys(h, key, entry->hash, entry->key)) {
+                size_t ctrlbyte_offset = CtrlChunk::mask_ctz(hit_mask);
+                Entry *entry = entry_at(aligned_entry_idx + ctrlbyte_offset);
+                if (eq(*entry)) {
 #if MEASURE_PATHS
                     PATH_AB++;
 #endif
                     slot = entry;
-                    ctrl_slot = (char *)ctrlchunks + i;
+                    ctrl_slot = &ctrlchunk->byte_at(ctrlbyte_offset);
                     return false;
                 }
-                hit_mask &= ~((ctrlmask_t)1 << hit_mask_tz);
-                hit_mask_tz = CtrlChunk::mask_ctz(hit_mask);
-            } else if (empty_mask) {
+                hit_mask &= hit_mask - 1;
+            }
+            // Nothing ever overflowed out of this chunk, so if the key isn't
+            // in here it isn't anywhere. Note that we can't stop at the first
+            // chunk with an empty byte, since `remove()` empties slots that
+            // other keys might have probed past.
+            if (overflows[ctrlchunk_idx] == 0) {
 #if MEASURE_PATHS
                 PATH_B++;
 #endif
-                // If we have no matches, but there is an empty slot, we just
-                // put it there
-                ctrlbyte_offset = empty_mask_tz;
-                size_t i = aligned_entry_idx + ctrlbyte_offset;
-                slot = entries + i;
-                ctrl_slot = (char *)ctrlchunks + i;
                 return true;
-            } else {
+            }
 #if MEASURE_PATHS
-                PATH_C++;
+            PATH_C++;
 #endif
-                // If we have no matches and there is no empty slot, we must
-                // continue probing in subsequent chunks
-                aligned_entry_idx = (aligned_entry_idx + CtrlChunk::NR_BYTES) % max_nr_entries;
-                ctrlchunk_idx = aligned_entry_idx / CtrlChunk::NR_BYTES;
-                ctrlchunk = ctrlchunks[ctrlchunk_idx];
-                hit_mask = simd<ctrlchunk_t>::movemask_eq(ctrlchunk.as_simd(), h7(h));
-                empty_mask =
-                    simd<ctrlchunk_t>::movemask_eq(ctrlchunk.as_simd(), CtrlChunk::CTRL_EMPTY);
-                hit_mask_tz = CtrlChunk::mask_ctz(hit_mask);
-                empty_mask_tz = CtrlChunk::mask_ctz(empty_mask);
+            ctrlchunk_idx = probe.next();
+        }
+        return true;
+    }
+
+    /**
+     * Find the first empty slot along the probe sequence for `h`, bumping the
+     * overflow count of every full ctrl chunk we have to walk past.
+     */
+    void get_empty_slot(size_t h, Entry *&slot, char *&ctrl_slot)
+    {
+        uint8_t *overflows = overflows_buf();
+
+        size_t ctrlchunk_idx = home_ctrlchunk_idx(h);
+        Probe probe(h, ctrlchunk_idx, nr_ctrlchunks());
+        while (true) {
+            CtrlChunk *ctrlchunk = ctrlchunk_at(ctrlchunk_idx);
+            ctrlmask_t empty_mask =
+                simd<ctrlchunk_t>::movemask_eq(ctrlchunk->as_simd(), CtrlChunk::CTRL_EMPTY);
+            if (empty_mask) {
+                size_t ctrlbyte_offset = CtrlChunk::mask_ctz(empty_mask);
+                slot = entry_at(ctrlchunk_idx * CtrlChunk::NR_BYTES + ctrlbyte_offset);
+                ctrl_slot = &ctrlchunk->byte_at(ctrlbyte_offset);
+                return;
             }
+            if (overflows[ctrlchunk_idx] != OVERFLOW_SATURATED) overflows[ctrlchunk_idx]++;
+            ctrlchunk_idx = probe.next();
         }
     }
 
+    /**
+     * Take the first empty slot along the probe sequence for `h` and mark it
+     * present. The returned entry is uninitialized, the caller must construct
+     * it.
+     */
+    Entry *claim_empty_slot(size_t h)
+    {
+        Entry *slot;
+        char *ctrl_slot;
+        get_empty_slot(h, slot, ctrl_slot);
+        *ctrl_slot = h7(h);
+        mark_occupied(ctrlchunk_idx_of(ctrl_slot));
+        nr_used++;
+        return slot;
+    }
+
+    /**
+     * Mark the slot at `ctrl_slot`, holding an entry with hash `h`, empty. The
+     * caller is responsible for the entry itself.
+     */
+    void release_slot(size_t h, char *ctrl_slot)
+    {
+        size_t ctrlchunk_idx = ctrlchunk_idx_of(ctrl_slot);
+        release_overflows(h, ctrlchunk_idx);
+        *ctrl_slot = CtrlChunk::CTRL_EMPTY;
+        update_occupancy(ctrlchunk_idx);
+        nr_used--;
+    }
+
+    /**
+     * Undo the overflow count bumps that `get_empty_slot` did when placing an
+     * entry with hash `h` into the ctrl chunk `dst_ctrlchunk_idx`.
+     */
+    void release_overflows(size_t h, size_t dst_ctrlchunk_idx)
+    {
+        uint8_t *overflows = overflows_buf();
+
+        size_t ctrlchunk_idx = home_ctrlchunk_idx(h);
+        Probe probe(h, ctrlchunk_idx, nr_ctrlchunks());
+        while (ctrlchunk_idx != dst_ctrlchunk_idx) {
+            if (overflows[ctrlchunk_idx] != OVERFLOW_SATURATED) overflows[ctrlchunk_idx]--;
+            ctrlchunk_idx = probe.next();
+        }
+    }
+
+public:
     /**
      * Insert a key-value pair into the hash-table, overriding an existing value
      * if there is one. 
@@ -579,27 +1393,135 @@ public:
      */
     Val *insert(Key key, Val val)
     {
-        size_t h = is_hashable<Key>::hash(key);
+        size_t h = Hasher::hash(key);
+        return insert_hashed(h, std::move(key), std::move(val));
+    }
+
+    /**
+     * `insert()` for when the caller has already computed `h`, e.g. to pick a
+     * shard, or to reuse it across several tables. `h` must be
+     * `Hasher::hash(key)`, which builds without `NDEBUG` check.
+     */
+    Val *insert_hashed(size_t h, Key key, Val val)
+    {
+        check_hash(h, key);
+        if (needs_to_grow()) grow();
+
         Entry *slot;
         char *ctrl_slot;
         bool empty = get_slot(h, key, slot, ctrl_slot);
         if (!empty) {
             slot->val = std::move(val);
         } else {
+            slot = claim_empty_slot(h);
             new (slot) Entry(h, std::move(key), std::move(val));
-            *ctrl_slot = h7(h);
         }
-        nr_used++;
         return &(slot->val);
     }
 
+    /**
+     * Insert the entry owned by `node`, using the hash cached in it, and
+     * overriding an existing value if there is one. Leaves `node` empty.
+     *
+     * # Returns
+     * A pointer to the value, or `nullptr` if `node` was empty
+     */
+    Val *insert(NodeHandle &&node)
+    {
+        if (node.empty()) return nullptr;
+        if (needs_to_grow()) grow();
+
+        size_t h = node.hash();
+        Entry *slot;
+        char *ctrl_slot;
+        bool empty = get_slot(h, node.key(), slot, ctrl_slot);
+        if (!empty) {
+            slot->val = std::move(node.val());
+            node.clear();
+        } else {
+            slot = claim_empty_slot(h);
+            relocate_entry(slot, &node.entry());
+            node.present = false;
+        }
+        return &(slot->val);
+    }
+
+    /**
+     * If `key` is present, apply `fn(val)` to its value, otherwise insert it
+     * with `init`. Only probes once, unlike a `get()` followed by an
+     * `insert()`, so this is what aggregations should use.
+     *
+     * # Returns
+     * A pointer to the value
+     */
+    template <typename Fn> Val *upsert(Key key, Val init, Fn fn)
+    {
+        size_t h = Hasher::hash(key);
+        return upsert_hashed(h, std::move(key), std::move(init), fn);
+    }
+
+    /**
+     * `upsert()` for when the caller has already computed `h`, which must be
+     * `Hasher::hash(key)`.
+     */
+    template <typename Fn> Val *upsert_hashed(size_t h, Key key, Val init, Fn fn)
+    {
+        check_hash(h, key);
+        if (needs_to_grow()) grow();
+
+        Entry *slot;
+        char *ctrl_slot;
+        if (get_slot(h, key, slot, ctrl_slot)) {
+            slot = claim_empty_slot(h);
+            new (slot) Entry(h, std::move(key), std::move(init));
+        } else {
+            fn(slot->val);
+        }
+        return &(slot->val);
+    }
+
+    /**
+     * Pull the entry that a lookup for `h` will most likely end up at into
+     * cache: the first h7 hit in the home ctrl chunk, or where an insert would
+     * go if there isn't one. Batch operations issue these a few keys ahead of
+     * the one they're working on, so that the ctrl chunk load and the entry
+     * miss overlap with the work on earlier keys.
+     */
+    void prefetch(size_t h) const
+    {
+        if (max_nr_entries == 0) return;
+        size_t ctrlchunk_idx = home_ctrlchunk_idx(h);
+        CtrlChunk *ctrlchunk = ctrlchunk_at(ctrlchunk_idx);
+        ctrlmask_t mask = simd<ctrlchunk_t>::movemask_eq(ctrlchunk->as_simd(), h7(h));
+        if (!mask) {
+            mask = simd<ctrlchunk_t>::movemask_eq(ctrlchunk->as_simd(), CtrlChunk::CTRL_EMPTY);
+        }
+        if (!mask) return;
+        __builtin_prefetch(entry_at(ctrlchunk_idx * CtrlChunk::NR_BYTES + CtrlChunk::mask_ctz(mask)),
+                           1, 3);
+    }
+
     /**
      * Get a pointer to the value at this key, or `nullptr` if it does not 
      * exist.
      */
     Val *get(Key const &key)
     {
-        size_t h = is_hashable<Key>::hash(key);
+        return find_hashed(Hasher::hash(key), key);
+    }
+
+    Val const *get(Key const &key) const
+    {
+        return find_hashed(Hasher::hash(key), key);
+    }
+
+    /**
+     * `get()` with a precomputed `h`, which must be
+     * `Hasher::hash(key)`.
+     */
+    Val *find_hashed(size_t h, Key const &key)
+    {
+        check_hash(h, key);
         Entry *slot;
         char *ctrl_slot;
         bool empty = get_slot(h, key, slot, ctrl_slot);
@@ -608,15 +1530,576 @@ public:
         return &slot->val;
     }
 
+    Val const *find_hashed(size_t h, Key const &key) const
+    {
+        check_hash(h, key);
+        Entry const *slot;
+        char const *ctrl_slot;
+        if (get_slot(h, key, slot, ctrl_slot)) return nullptr;
+        return &slot->val;
+    }
+
+    /** How many keys the batch operations hash at a time */
+    static const size_t BATCH_SIZE = 256;
+
+    /**
+     * Look up `n` keys, setting `out[i]` to a pointer to the value at
+     * `keys[i]`, or `nullptr` if it does not exist. The keys are hashed with
+     * `hash_batch()` a batch at a time, ahead of the probes. We don't
+     * `prefetch()` here: the lookups don't depend on each other, so the CPU
+     * already overlaps their misses, and the extra ctrl chunk reads only made
+     * tables that fit in cache slower.
+     *
+     * # Returns
+     * The number of keys found
+     */
+    size_t get_batch(Key const *keys, size_t n, Val **out)
+    {
+        size_t hashes[BATCH_SIZE];
+        size_t nr_found = 0;
+        for (size_t batch = 0; batch < n; batch += BATCH_SIZE) {
+            size_t batch_len = std::min((size_t)BATCH_SIZE, n - batch);
+            Key const *ks = keys + batch;
+            hash_batch<Key, Hasher>(ks, batch_len, hashes);
+            for (size_t i = 0; i < batch_len; ++i) {
+                Entry *slot;
+                char *ctrl_slot;
+                if (get_slot(hashes[i], ks[i], slot, ctrl_slot)) {
+                    out[batch + i] = nullptr;
+                } else {
+                    out[batch + i] = &slot->val;
+                    nr_found++;
+                }
+            }
+        }
+        return nr_found;
+    }
+
+    /**
+     * Insert `n` key-value pairs, overriding existing values (so a key that
+     * repeats ends up with its last value), hashing them a batch at a time
+     * like `get_batch()`. We `reserve()` for all of them first, so the table
+     * grows at most once.
+     */
+    void insert_batch(Key const *keys, Val const *vals, size_t n)
+    {
+        reserve(nr_used + n);
+        size_t hashes[BATCH_SIZE];
+        for (size_t batch = 0; batch < n; batch += BATCH_SIZE) {
+            size_t batch_len = std::min((size_t)BATCH_SIZE, n - batch);
+            Key const *ks = keys + batch;
+            Val const *vs = vals + batch;
+            hash_batch<Key, Hasher>(ks, batch_len, hashes);
+            for (size_t i = 0; i < batch_len; ++i) {
+                Entry *slot;
+                char *ctrl_slot;
+                if (get_slot(hashes[i], ks[i], slot, ctrl_slot)) {
+                    new (claim_empty_slot(hashes[i])) Entry(hashes[i], ks[i], vs[i]);
+                } else {
+                    slot->val = vs[i];
+                }
+            }
+        }
+    }
+
+    /**
+     * Remove and destruct the entry at `key`, if there is one. The slot goes
+     * straight back to being empty -- lookups rely on the overflow counts to
+     * know when to stop, so there is no need for a tombstone.
+     */
     void remove(Key const &key)
     {
-        size_t h = is_hashable<Key>::hash(key);
+        remove_hashed(Hasher::hash(key), key);
+    }
+
+    /**
+     * `remove()` with a precomputed `h`, which must be
+     * `Hasher::hash(key)`.
+     */
+    void remove_hashed(size_t h, Key const &key)
+    {
+        check_hash(h, key);
         Entry *slot;
         char *ctrl_slot;
-        // empty, no need to mark deleted
         if (get_slot(h, key, slot, ctrl_slot)) return;
-        *ctrl_slot = CtrlChunk::CTRL_DEL;
+        release_slot(h, ctrl_slot);
         slot->key.~Key();
         slot->val.~Val();
     }
-};
\ No newline at end of file
+
+    /**
+     * Move the entry at `key` out of the table, into a node handle that can be
+     * `insert()`-ed elsewhere. The node handle is empty if there is no such
+     * entry.
+     */
+    NodeHandle extract(Key const &key)
+    {
+        NodeHandle node;
+        size_t h = Hasher::hash(key);
+        Entry *slot;
+        char *ctrl_slot;
+        if (get_slot(h, key, slot, ctrl_slot)) return node;
+        release_slot(h, ctrl_slot);
+        relocate_entry(&node.entry(), slot);
+        node.present = true;
+        return node;
+    }
+
+    /**
+     * Move every entry of `other` into this table, leaving `other` empty. When
+     * a key is in both tables, `combiner(val, std::move(other_val))` gets to
+     * fold the other value into ours.
+     *
+     * This is a lot cheaper than `insert()`-ing every entry of `other`: we
+     * size the table for both up front so there is at most one `grow()`, and
+     * the entries carry their hash so nothing is rehashed.
+     */
+    template <typename Combiner> void merge(Self &&other, Combiner combiner)
+    {
+        if (&other == this || other.nr_used == 0) return;
+        if (nr_used == 0) {
+            // Nothing to combine with, just take the other buffer
+            free(buf);
+            buf = other.buf;
+            max_nr_entries = other.max_nr_entries;
+            nr_used = other.nr_used;
+            other.buf = nullptr;
+            other.max_nr_entries = 0;
+            other.nr_used = 0;
+            return;
+        }
+        size_t capacity = capacity_for(nr_used + other.nr_used);
+        if (capacity != max_nr_entries) rebuild(capacity);
+        for (size_t ctrlchunk_idx = other.next_occupied_ctrlchunk(0);
+             ctrlchunk_idx < other.nr_ctrlchunks();
+             ctrlchunk_idx = other.next_occupied_ctrlchunk(ctrlchunk_idx + 1)) {
+            ctrlmask_t present_mask = other.ctrlchunk_at(ctrlchunk_idx)->present_mask();
+            while (present_mask) {
+                size_t i = ctrlchunk_idx * CtrlChunk::NR_BYTES + CtrlChunk::mask_ctz(present_mask);
+                present_mask &= present_mask - 1;
+                Entry *e = other.entry_at(i);
+                Entry *slot;
+                char *ctrl_slot;
+                if (get_slot(e->hash, e->key, slot, ctrl_slot)) {
+                    relocate_entry(claim_empty_slot(e->hash), e);
+                } else {
+                    combiner(slot->val, std::move(e->val));
+                    e->~Entry();
+                }
+            }
+        }
+        free(other.buf);
+        other.buf = nullptr;
+        other.max_nr_entries = 0;
+        other.nr_used = 0;
+    }
+
+    /**
+     * Remove and destruct every entry for which `pred(key, val)` returns
+     * `true`.
+     *
+     * Rather than `remove()`-ing keys one at a time (rehashing and reprobing
+     * each), we walk the occupied ctrl chunks directly and clear every erased
+     * byte of a chunk with a single store. Entries sitting in their home chunk
+     * (most of them) don't have any overflow counts to release, so for those
+     * this is just the predicate and the destructors.
+     *
+     * # Returns
+     * The number of erased entries
+     */
+    template <typename Pred> size_t erase_if(Pred pred)
+    {
+        return erase_if_range(0, nr_ctrlchunks(), pred);
+    }
+
+    /**
+     * `erase_if()`, but only for the entries in ctrl chunks `from` up to (not
+     * including) `to`, so that a sweep over a big table can be done a bit at
+     * a time.
+     *
+     * # Returns
+     * The number of erased entries
+     */
+    template <typename Pred> size_t erase_if_range(size_t from, size_t to, Pred pred)
+    {
+        size_t nr_erased = 0;
+        if (to > nr_ctrlchunks()) to = nr_ctrlchunks();
+        size_t ctrlchunk_idx = next_occupied_ctrlchunk(from, to);
+        while (ctrlchunk_idx < to) {
+            CtrlChunk *ctrlchunk = ctrlchunk_at(ctrlchunk_idx);
+            size_t aligned_entry_idx = ctrlchunk_idx * CtrlChunk::NR_BYTES;
+            ctrlmask_t present_mask = ctrlchunk->present_mask();
+            ctrlmask_t erase_mask = 0;
+            while (present_mask) {
+                size_t ctrlbyte_offset = CtrlChunk::mask_ctz(present_mask);
+                present_mask &= present_mask - 1;
+                Entry *entry = entry_at(aligned_entry_idx + ctrlbyte_offset);
+                if (!pred(entry->key, entry->val)) continue;
+                if (home_ctrlchunk_idx(entry->hash) != ctrlchunk_idx) {
+                    release_overflows(entry->hash, ctrlchunk_idx);
+                }
+                entry->key.~Key();
+                entry->val.~Val();
+                erase_mask |= (ctrlmask_t)1 << ctrlbyte_offset;
+            }
+            if (erase_mask) {
+                ctrlchunk->set_empty(erase_mask);
+                update_occupancy(ctrlchunk_idx);
+                nr_erased += __builtin_popcount(erase_mask);
+            }
+            ctrlchunk_idx = next_occupied_ctrlchunk(ctrlchunk_idx + 1, to);
+        }
+        nr_used -= nr_erased;
+        return nr_erased;
+    }
+
+    /**
+     * Keep only the entries for which `pred(key, val)` returns `true`, see
+     * `erase_if()`.
+     *
+     * # Returns
+     * The number of erased entries
+     */
+    template <typename Pred> size_t retain(Pred pred)
+    {
+        return erase_if([&pred](Key const &key, Val &val) { return !pred(key, val); });
+    }
+
+    /**
+     * The number of ctrl chunks `get_slot` has to look at before it finds
+     * `key`, or before it knows that `key` is not here. Only really useful for
+     * measuring probe policies.
+     */
+    size_t probe_length(Key const &key) const
+    {
+        if (max_nr_entries == 0) return 0;
+        size_t h = Hasher::hash(key);
+        size_t ctrlchunk_idx = home_ctrlchunk_idx(h);
+        Probe probe(h, ctrlchunk_idx, nr_ctrlchunks());
+        for (size_t len = 1; len <= nr_ctrlchunks(); ++len) {
+            CtrlChunk *ctrlchunk = ctrlchunk_at(ctrlchunk_idx);
+            ctrlmask_t hit_mask = simd<ctrlchunk_t>::movemask_eq(ctrlchunk->as_simd(), h7(h));
+            while (hit_mask) {
+                size_t i = ctrlchunk_idx * CtrlChunk::NR_BYTES + CtrlChunk::mask_ctz(hit_mask);
+                Entry *entry = entry_at(i);
+                if (cmp_keys(h, key, entry->hash, entry->key)) return len;
+                hit_mask &= hit_mask - 1;
+            }
+            if (overflows_buf()[ctrlchunk_idx] == 0) return len;
+            ctrlchunk_idx = probe.next();
+        }
+        return nr_ctrlchunks();
+    }
+};
+/**
+ * A table for keys with so few possible values that each one can have a slot
+ * of its own: the key is the index, and a bitmap says which slots are used.
+ * There is no hashing, probing or key compare, and no growing either -- all
+ * the slots are allocated at once, on the first insert (so a 16-bit key
+ * costs `64K * sizeof(Val)` as soon as there is one entry).
+ *
+ * Use it in place of a `HashTbl` with 8- or 16-bit integer keys. It has the
+ * same interface for as far as that makes sense without hashes or ctrl chunks,
+ * but not the slot-level one that `HashCache`, `ExpiringTbl` and the like
+ * build on, which is why `HashTbl` isn't just specialized to it.
+ */
+template <typename Key, typename Val> struct DirectTbl
+{
+    static_assert(std::is_integral<Key>::value && sizeof(Key) <= 2,
+                  "DirectTbl is for 8- and 16-bit integer keys");
+    using Self = DirectTbl<Key, Val>;
+    typedef typename std::make_unsigned<Key>::type Idx;
+
+    static const size_t NR_SLOTS = (size_t)std::numeric_limits<Idx>::max() + 1;
+    static const size_t NR_PRESENT_WORDS = NR_SLOTS / 64;
+
+    struct Iter
+    {
+    private:
+        size_t idx;
+        /** `operator*` hands out a reference to the key, so we keep it here */
+        Key key;
+        Self const &tbl;
+
+    public:
+        Iter(Self const &tbl, size_t idx)
+            : idx(idx)
+            , key((Key)idx)
+            , tbl(tbl)
+        {
+        }
+
+        Iter &operator++()
+        {
+            idx = tbl.next_present(idx + 1);
+            key = (Key)idx;
+            return *this;
+        }
+
+        std::pair<Key const &, Val &> operator*()
+        {
+            return std::pair<Key const &, Val &>(key, *tbl.val_at(idx));
+        }
+
+        bool operator==(Iter const &other)
+        {
+            return idx == other.idx;
+        }
+
+        bool operator!=(Iter const &other)
+        {
+            return !(*this == other);
+        }
+    };
+
+private:
+    /*
+    +----------+
+    | present  |
+    | bitmap   |
+    +----------+
+    | vals     |
+    +----------+
+    */
+    uint8_t *buf;
+    size_t nr_used;
+
+    static const size_t BUF_ALIGNMENT =
+        alignof(Val) > alignof(uint64_t) ? alignof(Val) : alignof(uint64_t);
+
+    static size_t vals_offset()
+    {
+        return alignup(NR_PRESENT_WORDS * sizeof(uint64_t), BUF_ALIGNMENT);
+    }
+
+    uint64_t *present_buf() const
+    {
+        return (uint64_t *)buf;
+    }
+
+    Val *val_at(size_t idx) const
+    {
+        return (Val *)(buf + vals_offset()) + idx;
+    }
+
+    static size_t idx_of(Key key)
+    {
+        return (Idx)key;
+    }
+
+    bool is_present(size_t idx) const
+    {
+        return buf && (present_buf()[idx / 64] >> (idx % 64)) & 1;
+    }
+
+    /** The first used slot from `idx` on, or `NR_SLOTS` */
+    size_t next_present(size_t idx) const
+    {
+        if (!buf) return NR_SLOTS;
+        size_t word_idx = idx / 64;
+        if (word_idx >= NR_PRESENT_WORDS) return NR_SLOTS;
+        uint64_t word = present_buf()[word_idx] & (~(uint64_t)0 << (idx % 64));
+        while (!word) {
+            if (++word_idx == NR_PRESENT_WORDS) return NR_SLOTS;
+            word = present_buf()[word_idx];
+        }
+        return word_idx * 64 + __builtin_ctzll(word);
+    }
+
+    void alloc()
+    {
+        if (posix_memalign((void **)&buf, BUF_ALIGNMENT, vals_offset() + NR_SLOTS * sizeof(Val))) {
+            throw std::runtime_error("OOM");
+        }
+        memset(buf, 0, vals_offset());
+    }
+
+    /** Mark `idx` used and construct its value, which must not be there yet */
+    Val *emplace(size_t idx, Val val)
+    {
+        if (!buf) alloc();
+        present_buf()[idx / 64] |= (uint64_t)1 << (idx % 64);
+        nr_used++;
+        return new (val_at(idx)) Val(std::move(val));
+    }
+
+    void erase(size_t idx)
+    {
+        present_buf()[idx / 64] &= ~((uint64_t)1 << (idx % 64));
+        nr_used--;
+        val_at(idx)->~Val();
+    }
+
+public:
+    DirectTbl()
+        : buf(nullptr)
+        , nr_used(0)
+    {
+    }
+
+    DirectTbl(DirectTbl const &) = delete;
+    DirectTbl &operator=(DirectTbl const &) = delete;
+
+    DirectTbl(DirectTbl &&other) noexcept
+        : buf(other.buf)
+        , nr_used(other.nr_used)
+    {
+        other.buf = nullptr;
+        other.nr_used = 0;
+    }
+
+    DirectTbl &operator=(DirectTbl &&rhs) noexcept
+    {
+        std::swap(buf, rhs.buf);
+        std::swap(nr_used, rhs.nr_used);
+        return *this;
+    }
+
+    ~DirectTbl()
+    {
+        if (buf) {
+            for (size_t idx = next_present(0); idx < NR_SLOTS; idx = next_present(idx + 1)) {
+                val_at(idx)->~Val();
+            }
+            free(buf);
+            buf = nullptr;
+        }
+    }
+
+    size_t size() const
+    {
+        return nr_used;
+    }
+
+    /** Keys come out in the order of their unsigned value */
+    Iter begin() const
+    {
+        return Iter(*this, next_present(0));
+    }
+
+    Iter end() const
+    {
+        return Iter(*this, NR_SLOTS);
+    }
+
+    /**
+     * Insert a key-value pair, overriding an existing value if there is one.
+     *
+     * # Returns
+     * A pointer to the value
+     */
+    Val *insert(Key key, Val val)
+    {
+        size_t idx = idx_of(key);
+        if (!is_present(idx)) return emplace(idx, std::move(val));
+        *val_at(idx) = std::move(val);
+        return val_at(idx);
+    }
+
+    /**
+     * If `key` is present, apply `fn(val)` to its value, otherwise insert it
+     * with `init`.
+     *
+     * # Returns
+     * A pointer to the value
+     */
+    template <typename Fn> Val *upsert(Key key, Val init, Fn fn)
+    {
+        size_t idx = idx_of(key);
+        if (!is_present(idx)) return emplace(idx, std::move(init));
+        fn(*val_at(idx));
+        return val_at(idx);
+    }
+
+    /**
+     * Get a pointer to the value at this key, or `nullptr` if it does not
+     * exist.
+     */
+    Val *get(Key const &key)
+    {
+        size_t idx = idx_of(key);
+        return is_present(idx) ? val_at(idx) : nullptr;
+    }
+
+    Val const *get(Key const &key) const
+    {
+        size_t idx = idx_of(key);
+        return is_present(idx) ? val_at(idx) : nullptr;
+    }
+
+    void remove(Key const &key)
+    {
+        size_t idx = idx_of(key);
+        if (is_present(idx)) erase(idx);
+    }
+
+    // The key is its own slot index, so the `_hashed` operations are only
+    // here for code that doesn't know which table it's got
+    Val *insert_hashed(size_t, Key key, Val val)
+    {
+        return insert(key, std::move(val));
+    }
+
+    Val *find_hashed(size_t, Key const &key)
+    {
+        return get(key);
+    }
+
+    Val const *find_hashed(size_t, Key const &key) const
+    {
+        return get(key);
+    }
+
+    void remove_hashed(size_t, Key const &key)
+    {
+        remove(key);
+    }
+
+    // There's a slot for every key already, so there is nothing to size, but
+    // an empty table can still give its buffer back
+    void reserve(size_t)
+    {
+    }
+
+    void rehash(size_t capacity)
+    {
+        if (capacity == 0) shrink_to_fit();
+    }
+
+    void shrink_to_fit()
+    {
+        if (nr_used || !buf) return;
+        free(buf);
+        buf = nullptr;
+    }
+
+    /**
+     * Remove and destruct every entry for which `pred(key, val)` returns
+     * `true`.
+     *
+     * # Returns
+     * The number of erased entries
+     */
+    template <typename Pred> size_t erase_if(Pred pred)
+    {
+        size_t nr_erased = 0;
+        for (size_t idx = next_present(0); idx < NR_SLOTS; idx = next_present(idx + 1)) {
+            Key const key = (Key)idx;
+            if (!pred(key, *val_at(idx))) continue;
+            erase(idx);
+            nr_erased++;
+        }
+        return nr_erased;
+    }
+
+    /**
+     * Keep only the entries for which `pred(key, val)` returns `true`.
+     *
+     * # Returns
+     * The number of erased entries
+     */
+    template <typename Pred> size_t retain(Pred pred)
+    {
+        return erase_if([&pred](Key const &key, Val &val) { return !pred(key, val); });
+    }
+};
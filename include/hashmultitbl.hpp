@@ -0,0 +1,186 @@
+#pragma once
+
+#include "hashmap.hpp"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/**
+ * A hash table with any number of values per key.
+ *
+ * Each key maps to a run of its values in one packed side vector, so reading
+ * every value of a key is a single lookup followed by a contiguous scan, and
+ * there is no allocation per key. A run has some spare capacity after it. When
+ * it fills up, it moves to the end of the vector with double the capacity (or
+ * just grows in place if it is already at the end), leaving a hole behind. The
+ * vector is compacted once the holes add up to more than the values.
+ *
+ * `Val` must be default constructible.
+ */
+template <typename Key, typename Val> class HashMultiTbl
+{
+public:
+    /** Where a key's values are in `vals` */
+    struct Run
+    {
+        uint32_t offset;
+        uint32_t len;
+        uint32_t cap;
+    };
+
+    typedef HashTbl<Key, Run> tbl_t;
+    typedef typename tbl_t::Entry Entry;
+
+private:
+    tbl_t tbl;
+    std::vector<Val> vals;
+    /** The number of values, i.e. the sum of the lengths of all runs */
+    size_t nr_vals;
+    /** How many slots of `vals` no run covers */
+    size_t nr_dead;
+
+    /**
+     * Make room for at least `cap` values in `run`, keeping the first
+     * `nr_keep` of the ones it has.
+     */
+    void grow_run(Run &run, size_t cap, size_t nr_keep)
+    {
+        if (cap < run.cap * 2) cap = run.cap * 2;
+        bool at_end = (size_t)run.offset + run.cap == vals.size();
+        size_t offset = at_end ? run.offset : vals.size();
+        if (offset + cap > std::numeric_limits<uint32_t>::max()) {
+            throw std::runtime_error("too many values");
+        }
+        if (at_end) {
+            vals.resize(run.offset + cap);
+            run.cap = cap;
+            return;
+        }
+        vals.resize(offset + cap);
+        std::move(vals.begin() + run.offset, vals.begin() + run.offset + nr_keep,
+                  vals.begin() + offset);
+        nr_dead += run.cap;
+        run.offset = offset;
+        run.cap = cap;
+    }
+
+    /**
+     * Move every run next to each other, in table order, trimming their spare
+     * capacity.
+     */
+    void compact()
+    {
+        std::vector<Val> packed;
+        packed.reserve(nr_vals);
+        for (auto kv : tbl) {
+            Run &run = kv.second;
+            uint32_t offset = packed.size();
+            std::move(vals.begin() + run.offset, vals.begin() + run.offset + run.len,
+                      std::back_inserter(packed));
+            run.offset = offset;
+            run.cap = run.len;
+        }
+        vals.swap(packed);
+        nr_dead = 0;
+    }
+
+    void maybe_compact()
+    {
+        if (nr_dead > nr_vals) compact();
+    }
+
+public:
+    HashMultiTbl()
+        : nr_vals(0)
+        , nr_dead(0)
+    {
+    }
+
+    /**
+     * Add `val` to the values at `key`, after any that are already there.
+     */
+    void insert(Key key, Val val)
+    {
+        Run *run = tbl.upsert(std::move(key), Run{(uint32_t)vals.size(), 0, 0}, [](Run &) {});
+        if (run->len == run->cap) {
+            maybe_compact();
+            grow_run(*run, 1, run->len);
+        }
+        vals[run->offset + run->len++] = std::move(val);
+        nr_vals++;
+    }
+
+    /**
+     * Insert `n` key-value pairs. Keys that repeat within the batch only have
+     * their run grown once, to fit all of their new values.
+     */
+    void insert_batch(Key const *keys, Val const *batch_vals, size_t n)
+    {
+        // Make sure the table won't grow under us, so that entry pointers stay
+        // put between the two passes
+        tbl.reserve(tbl.size() + n);
+        maybe_compact();
+
+        // First pass: find each row's run and its position in it
+        std::vector<Run *> runs(n);
+        std::vector<uint32_t> positions(n);
+        for (size_t i = 0; i < n; ++i) {
+            runs[i] = tbl.upsert(keys[i], Run{(uint32_t)vals.size(), 0, 0}, [](Run &) {});
+            positions[i] = runs[i]->len++;
+        }
+        // Second pass: the first row of each key past the end of its run
+        // grows it to fit the whole batch, then every row goes into place.
+        // Rows before that one were written within the old capacity, which
+        // `grow_run` keeps.
+        for (size_t i = 0; i < n; ++i) {
+            Run &run = *runs[i];
+            if (run.len > run.cap) grow_run(run, run.len, run.cap);
+            vals[run.offset + positions[i]] = batch_vals[i];
+        }
+        nr_vals += n;
+    }
+
+    /**
+     * The values at `key`, in insertion order, as a `[begin, end)` pair (both
+     * `nullptr` if there are none). Invalidated by inserts.
+     */
+    std::pair<Val *, Val *> equal_range(Key const &key)
+    {
+        Run *run = tbl.get(key);
+        if (!run || run->len == 0) return std::pair<Val *, Val *>(nullptr, nullptr);
+        Val *begin = &vals[run->offset];
+        return std::pair<Val *, Val *>(begin, begin + run->len);
+    }
+
+    size_t count(Key const &key) const
+    {
+        Run const *run = tbl.get(key);
+        return run ? run->len : 0;
+    }
+
+    /**
+     * Drop every value at `key`.
+     */
+    void remove(Key const &key)
+    {
+        Run *run = tbl.get(key);
+        if (!run) return;
+        nr_vals -= run->len;
+        nr_dead += run->cap;
+        tbl.remove(key);
+        maybe_compact();
+    }
+
+    /** The number of values */
+    size_t size() const
+    {
+        return nr_vals;
+    }
+
+    size_t nr_keys() const
+    {
+        return tbl.size();
+    }
+};
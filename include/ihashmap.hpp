@@ -95,9 +95,11 @@ template <typename K, typename V> struct IMap<default_std_unordered_map_t, K, V>
     }
 };
 
-template <typename K, typename V> struct IMap<HashTbl, K, V>
+template <typename K, typename V> using hashtbl_t = HashTbl<K, V>;
+
+template <typename K, typename V> struct IMap<hashtbl_t, K, V>
 {
-    using Map = HashTbl<K, V>;
+    using Map = hashtbl_t<K, V>;
     static constexpr bool implements = true;
 
     static void insert(Map &map, K k, V v)
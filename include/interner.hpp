@@ -0,0 +1,121 @@
+#pragma once
+
+#include "hashmap.hpp"
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Maps strings to dense `uint32_t` IDs (in the order they were first seen)
+ * and back.
+ *
+ * The bytes of each string are stored exactly once, in an append-only arena
+ * of big chunks, and never move. The table's keys and the ID-to-string array
+ * both point into the arena, so interning a new string costs no allocation
+ * of its own, and looking one up costs none at all.
+ */
+class StringInterner
+{
+public:
+    /** Strings longer than this get an arena chunk to themselves */
+    static const size_t CHUNK_SIZE = 64 * 1024;
+
+    typedef HashTbl<std::string_view, uint32_t> tbl_t;
+    typedef tbl_t::Entry Entry;
+
+private:
+    tbl_t tbl;
+    std::vector<std::string_view> strs;
+    std::vector<std::unique_ptr<char[]>> chunks;
+    /** Where the next string goes in the last chunk, and how much room is left */
+    char *arena_head;
+    size_t arena_left;
+    /** The sum of all chunk sizes */
+    size_t arena_bytes;
+
+    char *alloc(size_t len)
+    {
+        if (len > CHUNK_SIZE) {
+            // Leave the current chunk as it is, it might still have room
+            chunks.emplace_back(new char[len]);
+            arena_bytes += len;
+            return chunks.back().get();
+        }
+        if (len > arena_left) {
+            chunks.emplace_back(new char[CHUNK_SIZE]);
+            arena_head = chunks.back().get();
+            arena_left = CHUNK_SIZE;
+            arena_bytes += CHUNK_SIZE;
+        }
+        char *dst = arena_head;
+        arena_head += len;
+        arena_left -= len;
+        return dst;
+    }
+
+public:
+    StringInterner()
+        : arena_head(nullptr)
+        , arena_left(0)
+        , arena_bytes(0)
+    {
+    }
+
+    /**
+     * The ID of `str`, giving it the next one if it hasn't been seen before.
+     */
+    uint32_t intern(std::string_view str)
+    {
+        size_t h = is_hashable<std::string_view>::hash(str);
+        Entry *slot;
+        char *ctrl_slot;
+        if (!tbl.get_slot(h, str, slot, ctrl_slot)) return slot->val;
+
+        if (strs.size() >= std::numeric_limits<uint32_t>::max()) {
+            throw std::runtime_error("too many strings");
+        }
+        char *data = alloc(str.size());
+        if (!str.empty()) memcpy(data, str.data(), str.size());
+        std::string_view owned(data, str.size());
+        uint32_t id = strs.size();
+        strs.push_back(owned);
+        if (tbl.needs_to_grow()) tbl.grow();
+        new (tbl.claim_empty_slot(h)) Entry(h, owned, id);
+        return id;
+    }
+
+    /**
+     * Get a pointer to the ID of `str`, or `nullptr` if it hasn't been
+     * interned.
+     */
+    uint32_t const *find(std::string_view str)
+    {
+        return tbl.get(str);
+    }
+
+    /**
+     * The string with ID `id`. It stays valid for as long as the interner.
+     */
+    std::string_view str(uint32_t id) const
+    {
+        return strs[id];
+    }
+
+    size_t size() const
+    {
+        return strs.size();
+    }
+
+    /**
+     * About how many bytes we've allocated, for the arena, the table and the
+     * ID array.
+     */
+    size_t memory_usage() const
+    {
+        return arena_bytes + tbl.nr_ctrlchunks() * CtrlChunk::NR_BYTES * (sizeof(Entry) + 1) +
+               strs.capacity() * sizeof(std::string_view);
+    }
+};
@@ -0,0 +1,414 @@
+#pragma once
+
+#include "hashmap.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * Compares a key against a whole group of 16 keys at once, giving a bit per
+ * key that's equal. Only for keys small enough that a group fits in a vector
+ * register or two. Without SSE2, it's a plain loop over the group.
+ */
+template <typename Key> struct KeyColumn
+{
+    static constexpr bool value = false;
+};
+
+template <typename Key> inline uint16_t match_key_group_scalar(Key const *keys, Key key)
+{
+    uint16_t mask = 0;
+    for (size_t i = 0; i < 16; ++i) {
+        mask |= (uint16_t)(keys[i] == key) << i;
+    }
+    return mask;
+}
+
+template <> struct KeyColumn<uint32_t>
+{
+    static constexpr bool value = true;
+
+    /** `keys` must be 64-byte aligned */
+    static uint16_t match(uint32_t const *keys, uint32_t key)
+    {
+#ifdef __SSE2__
+        return simd_impl::match_u32_group_sse2(keys, key);
+#else
+        return match_key_group_scalar(keys, key);
+#endif
+    }
+};
+
+template <> struct KeyColumn<uint16_t>
+{
+    static constexpr bool value = true;
+
+    /** `keys` must be 32-byte aligned */
+    static uint16_t match(uint16_t const *keys, uint16_t key)
+    {
+#ifdef __SSE2__
+        __m128i const needle = _mm_set1_epi16(key);
+        __m128i const *group = (__m128i const *)keys;
+        return _mm_movemask_epi8(
+            _mm_packs_epi16(_mm_cmpeq_epi16(_mm_load_si128(group), needle),
+                            _mm_cmpeq_epi16(_mm_load_si128(group + 1), needle)));
+#else
+        return match_key_group_scalar(keys, key);
+#endif
+    }
+};
+
+#ifdef __SSE2__
+/**
+ * `KeyColumn<Key>`, but with the compare for `LEVEL`, for the batches that
+ * pick a level once. Only `uint32_t` keys have wider compares.
+ */
+template <typename Key, SimdLevel LEVEL> struct KeyColumnAt : KeyColumn<Key>
+{
+};
+
+template <> struct KeyColumnAt<uint32_t, SimdLevel::AVX2>
+{
+    __attribute__((target("avx2"))) static uint16_t match(uint32_t const *keys, uint32_t key)
+    {
+        return simd_impl::match_u32_group_avx2(keys, key);
+    }
+};
+
+template <> struct KeyColumnAt<uint32_t, SimdLevel::AVX512>
+{
+    __attribute__((target("avx512f"))) static uint16_t match(uint32_t const *keys, uint32_t key)
+    {
+        return simd_impl::match_u32_group_avx512(keys, key);
+    }
+};
+#endif
+
+/**
+ * A hash table for `uint32_t` or `uint16_t` keys that compares keys directly
+ * instead of going through h7 tags.
+ *
+ * Slots come in groups of 16, and each group's keys are stored next to each
+ * other (so a group of `uint32_t` keys is exactly one cache line), with the
+ * values in a separate array. A lookup compares its key against the whole
+ * group with a few vector instructions, so there are no tag false positives
+ * to weed out and no entry to load before we know we have a hit. Instead of
+ * ctrl bytes, a group has a 16-bit mask of which of its slots are used, plus
+ * the same F14-style overflow count as `HashTbl`'s ctrl chunks, so there are
+ * no tombstones either.
+ */
+template <typename Key, typename Val> class KeyColumnTbl
+{
+    static_assert(KeyColumn<Key>::value, "Key must be uint32_t or uint16_t");
+
+public:
+    static const size_t GROUP_LEN = 16;
+
+private:
+    static const size_t GROUP_ALIGNMENT = 64;
+    static const uint8_t OVERFLOW_SATURATED = 255;
+    static const uint16_t FULL_MASK = 0xffff;
+
+    /**
+     * One buffer: the key groups, then each group's used mask and overflow
+     * count, then the values
+     */
+    uint8_t *buf;
+    size_t nr_groups;
+    /** Shifts a mixed key down to a group index */
+    size_t group_shift;
+    size_t nr_used;
+
+    static size_t masks_offset(size_t nr_groups)
+    {
+        return alignup(nr_groups * GROUP_LEN * sizeof(Key), GROUP_ALIGNMENT);
+    }
+
+    static size_t overflows_offset(size_t nr_groups)
+    {
+        return masks_offset(nr_groups) + nr_groups * sizeof(uint16_t);
+    }
+
+    static size_t vals_offset(size_t nr_groups)
+    {
+        return alignup(overflows_offset(nr_groups) + nr_groups, alignof(Val) > 8 ? alignof(Val) : 8);
+    }
+
+    Key *group_keys(size_t group_idx)
+    {
+        return (Key *)buf + group_idx * GROUP_LEN;
+    }
+
+    Key const *group_keys(size_t group_idx) const
+    {
+        return (Key const *)buf + group_idx * GROUP_LEN;
+    }
+
+    uint16_t *used_masks()
+    {
+        return (uint16_t *)(buf + masks_offset(nr_groups));
+    }
+
+    uint16_t const *used_masks() const
+    {
+        return (uint16_t const *)(buf + masks_offset(nr_groups));
+    }
+
+    uint8_t *overflows()
+    {
+        return buf + overflows_offset(nr_groups);
+    }
+
+    uint8_t const *overflows() const
+    {
+        return buf + overflows_offset(nr_groups);
+    }
+
+    Val *val_at(size_t slot_idx)
+    {
+        return (Val *)(buf + vals_offset(nr_groups)) + slot_idx;
+    }
+
+    Val const *val_at(size_t slot_idx) const
+    {
+        return (Val const *)(buf + vals_offset(nr_groups)) + slot_idx;
+    }
+
+    size_t home_group(Key key) const
+    {
+        // Keys are often dense, so mix them before taking the group
+        return (size_t)(((uint64_t)key * 0x9e3779b97f4a7c15) >> group_shift);
+    }
+
+    size_t next_group(size_t group_idx) const
+    {
+        return (group_idx + 1) & (nr_groups - 1);
+    }
+
+    /**
+     * The index of the slot holding `key`, or `nr_slots()` if there is none,
+     * comparing groups with `Column::match()`.
+     */
+    template <typename Column> size_t find_slot_with(Key key) const
+    {
+        if (nr_groups == 0) return 0;
+        uint16_t const *masks = used_masks();
+        size_t group_idx = home_group(key);
+        for (size_t nr_probed = 0; nr_probed < nr_groups; ++nr_probed) {
+            uint16_t hits = Column::match(group_keys(group_idx), key) & masks[group_idx];
+            if (hits) return group_idx * GROUP_LEN + __builtin_ctz(hits);
+            if (overflows()[group_idx] == 0) break;
+            group_idx = next_group(group_idx);
+        }
+        return nr_slots();
+    }
+
+    size_t find_slot(Key key) const
+    {
+        return find_slot_with<KeyColumn<Key>>(key);
+    }
+
+    template <typename Column> void get_batch_with(Key const *keys, size_t n, Val **vals)
+    {
+        for (size_t i = 0; i < n; ++i) {
+            size_t slot_idx = find_slot_with<Column>(keys[i]);
+            vals[i] = slot_idx < nr_slots() ? val_at(slot_idx) : nullptr;
+        }
+    }
+
+#ifdef __SSE2__
+    // `flatten` inlines the whole loop, compare included, so these are AVX2
+    // and AVX-512 copies of it with no call per probe
+    __attribute__((target("avx2"), flatten)) void get_batch_avx2(Key const *keys, size_t n, Val **vals)
+    {
+        get_batch_with<KeyColumnAt<Key, SimdLevel::AVX2>>(keys, n, vals);
+    }
+
+    __attribute__((target("avx512f"), flatten)) void get_batch_avx512(Key const *keys, size_t n, Val **vals)
+    {
+        get_batch_with<KeyColumnAt<Key, SimdLevel::AVX512>>(keys, n, vals);
+    }
+#endif
+
+    /**
+     * Claim the first free slot along `key`'s probe sequence, bumping the
+     * overflow count of every full group on the way. Doesn't check whether
+     * `key` is already there.
+     */
+    size_t claim_slot(Key key)
+    {
+        uint16_t *masks = used_masks();
+        size_t group_idx = home_group(key);
+        while (masks[group_idx] == FULL_MASK) {
+            if (overflows()[group_idx] != OVERFLOW_SATURATED) overflows()[group_idx]++;
+            group_idx = next_group(group_idx);
+        }
+        size_t offset = __builtin_ctz((uint16_t)~masks[group_idx]);
+        masks[group_idx] |= 1 << offset;
+        group_keys(group_idx)[offset] = key;
+        nr_used++;
+        return group_idx * GROUP_LEN + offset;
+    }
+
+    bool needs_to_grow() const
+    {
+        return nr_used >= nr_slots() / 4 * 3;
+    }
+
+    void grow()
+    {
+        KeyColumnTbl bigger(nr_groups ? nr_groups * 2 : 4);
+        for (size_t group_idx = 0; group_idx < nr_groups; ++group_idx) {
+            uint16_t mask = used_masks()[group_idx];
+            while (mask) {
+                size_t slot_idx = group_idx * GROUP_LEN + __builtin_ctz(mask);
+                mask &= mask - 1;
+                Val *val = val_at(slot_idx);
+                new (bigger.val_at(bigger.claim_slot(group_keys(group_idx)[slot_idx % GROUP_LEN])))
+                    Val(std::move(*val));
+                val->~Val();
+            }
+        }
+        free(buf);
+        buf = bigger.buf;
+        nr_groups = bigger.nr_groups;
+        group_shift = bigger.group_shift;
+        bigger.buf = nullptr;
+        bigger.nr_groups = 0;
+    }
+
+    /** An empty table with `nr_groups` groups, which must be a power of 2 */
+    explicit KeyColumnTbl(size_t nr_groups)
+        : buf(nullptr)
+        , nr_groups(nr_groups)
+        , group_shift(64 - __builtin_ctzll(nr_groups))
+        , nr_used(0)
+    {
+        size_t size = vals_offset(nr_groups) + nr_slots() * sizeof(Val);
+        if (posix_memalign((void **)&buf, GROUP_ALIGNMENT, size)) {
+            throw std::runtime_error("OOM");
+        }
+        memset(buf + masks_offset(nr_groups), 0, vals_offset(nr_groups) - masks_offset(nr_groups));
+    }
+
+public:
+    KeyColumnTbl()
+        : buf(nullptr)
+        , nr_groups(0)
+        , group_shift(64)
+        , nr_used(0)
+    {
+    }
+
+    KeyColumnTbl(KeyColumnTbl const &) = delete;
+    KeyColumnTbl &operator=(KeyColumnTbl const &) = delete;
+
+    ~KeyColumnTbl()
+    {
+        if (!buf) return;
+        for_each([](Key, Val &val) { val.~Val(); });
+        free(buf);
+    }
+
+    /**
+     * Insert a key-value pair, overriding the value if the key already exists.
+     *
+     * # Returns
+     * A pointer to the value
+     */
+    Val *insert(Key key, Val val)
+    {
+        size_t slot_idx = find_slot(key);
+        if (slot_idx < nr_slots()) {
+            *val_at(slot_idx) = std::move(val);
+            return val_at(slot_idx);
+        }
+        if (needs_to_grow()) grow();
+        Val *dst = val_at(claim_slot(key));
+        new (dst) Val(std::move(val));
+        return dst;
+    }
+
+    /**
+     * Get a pointer to the value at this key, or `nullptr` if it does not
+     * exist.
+     */
+    Val *get(Key key)
+    {
+        size_t slot_idx = find_slot(key);
+        return slot_idx < nr_slots() ? val_at(slot_idx) : nullptr;
+    }
+
+    Val const *get(Key key) const
+    {
+        size_t slot_idx = find_slot(key);
+        return slot_idx < nr_slots() ? val_at(slot_idx) : nullptr;
+    }
+
+    /**
+     * Look up `n` keys, setting `vals[i]` to a pointer to the value at
+     * `keys[i]`, or `nullptr` if it does not exist.
+     *
+     * Unlike `get()`, which always compares with SSE2, this picks the compare
+     * from `simd_kernels()` once for the whole batch, so it gets AVX2 or
+     * AVX-512 where the CPU has them.
+     */
+    void get_batch(Key const *keys, size_t n, Val **vals)
+    {
+#ifdef __SSE2__
+        switch (simd_kernels().level) {
+        case SimdLevel::AVX512:
+            return get_batch_avx512(keys, n, vals);
+        case SimdLevel::AVX2:
+            return get_batch_avx2(keys, n, vals);
+        case SimdLevel::SSE2:
+            break;
+        }
+#endif
+        get_batch_with<KeyColumn<Key>>(keys, n, vals);
+    }
+
+    void remove(Key key)
+    {
+        size_t slot_idx = find_slot(key);
+        if (slot_idx >= nr_slots()) return;
+        size_t dst_group_idx = slot_idx / GROUP_LEN;
+        // Undo the overflow bumps from when this key was inserted
+        for (size_t group_idx = home_group(key); group_idx != dst_group_idx;
+             group_idx = next_group(group_idx)) {
+            if (overflows()[group_idx] != OVERFLOW_SATURATED) overflows()[group_idx]--;
+        }
+        used_masks()[dst_group_idx] &= ~(1 << (slot_idx % GROUP_LEN));
+        val_at(slot_idx)->~Val();
+        nr_used--;
+    }
+
+    /**
+     * Call `f(key, val)` for every entry.
+     */
+    template <typename F> void for_each(F f)
+    {
+        for (size_t group_idx = 0; group_idx < nr_groups; ++group_idx) {
+            uint16_t mask = used_masks()[group_idx];
+            while (mask) {
+                size_t offset = __builtin_ctz(mask);
+                mask &= mask - 1;
+                f(group_keys(group_idx)[offset], *val_at(group_idx * GROUP_LEN + offset));
+            }
+        }
+    }
+
+    size_t size() const
+    {
+        return nr_used;
+    }
+
+    size_t nr_slots() const
+    {
+        return nr_groups * GROUP_LEN;
+    }
+};
@@ -1,31 +1,43 @@
 #pragma once
 
-#include <emmintrin.h>
 #include <cstdint>
 #include <limits>
 #include <cstring>
-#pragma GCC target("bmi")
-#include <x86intrin.h>
+#include <stdexcept>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
 
 template <size_t NR_BITS> struct unsigned_int
 {
 };
 
+template <> struct unsigned_int<8>
+{
+    using type = uint8_t;
+
+    /** Count trailing zeros on this u8. If the u8 is 0 the result is `8`. */
+    static inline type ctz(uint8_t n)
+    {
+        return (type)__builtin_ctz((uint32_t)n | 0x100);
+    }
+};
+
 template <> struct unsigned_int<16>
 {
     using type = uint16_t;
 
     /**
-     * Count trailing zeros on this u16. If the u16 is 0 the result is 
-     * an indeterminate value in the range `16..`
+     * Count trailing zeros on this u16. If the u16 is 0 the result is `16`.
+     *
+     * Setting bit 16 makes the zero case well-defined without a branch, so
+     * this is a plain `bsf` (or `tzcnt`, when built with BMI) with no target
+     * attributes that could fault on CPUs without them.
      */
-    __attribute__((target("avx2"))) static inline type ctz(uint16_t n)
+    static inline type ctz(uint16_t n)
     {
-#ifdef __x86_64__
-        return (uint16_t)_tzcnt_u32(n);
-#else
-        return n ? __builtin_ctz(n) : 16;
-#endif
+        return (type)__builtin_ctz((uint32_t)n | 0x10000);
     }
 };
 
@@ -38,6 +50,7 @@ template <typename T> struct usimd
 {
 };
 
+#ifdef __SSE2__
 /**
  * - x86 is little-endian, so our pointer-dereference bitcasts are all 
  *   just as-you-would-expect truncations.  
@@ -56,6 +69,27 @@ template <> struct usimd<__m128i>
         return _mm_cmpeq_epi8(a, b);
     }
 
+    static __m128i or_i8(__m128i a, __m128i b)
+    {
+        return _mm_or_si128(a, b);
+    }
+
+    /**
+     * The inverse of `movemask_i8`, every byte whose bit is set in `mask`
+     * becomes `0xff` and every other byte becomes `0`.
+     */
+    static __m128i unmovemask_i8(movemask_t mask)
+    {
+        // Broadcast the low byte of the mask to the low 8 bytes and the high
+        // byte to the high 8 bytes, then check each byte for its own bit. The
+        // products only fit unsigned.
+        __m128i const bits = _mm_set1_epi64x(0x8040201008040201);
+        uint64_t const lo = (uint64_t)0x0101010101010101 * (uint64_t)(mask & 0xff);
+        uint64_t const hi = (uint64_t)0x0101010101010101 * (uint64_t)(mask >> 8);
+        __m128i const bcast = _mm_set_epi64x((long long)hi, (long long)lo);
+        return _mm_cmpeq_epi8(_mm_and_si128(bcast, bits), bits);
+    }
+
     static movemask_t movemask_i8(__m128i i)
     {
         // dw, this is as you would expect,
@@ -67,6 +101,64 @@ template <> struct usimd<__m128i>
         return ret;
     }
 };
+#endif
+
+/**
+ * SWAR ("SIMD within a register"): 8 bytes at a time in a plain `uint64_t`,
+ * for targets (or sanitizer builds) without SSE2. Byte lanes are the bytes of
+ * the word in little-endian order, so lane `i` is bits `8i..8i+7`, and a
+ * "true" lane is `0xff` like with SSE2.
+ */
+template <> struct usimd<uint64_t>
+{
+    using movemask_t = typename movemask_t<uint64_t>::type;
+
+    static const uint64_t LOW_BITS = 0x0101010101010101;
+    static const uint64_t HIGH_BITS = 0x8080808080808080;
+
+    static uint64_t splat_i8(char b)
+    {
+        return LOW_BITS * (uint8_t)b;
+    }
+
+    /**
+     * The usual has-zero-byte trick (`(x - 0x01..) & ~x & 0x80..`) can flag
+     * the byte above a real zero byte, because of the borrow. Adding `0x7f`
+     * to the low 7 bits of each byte can't carry into the next byte, so this
+     * version is exact, which it has to be for `movemask_eq`.
+     */
+    static uint64_t cmpeq_i8(uint64_t a, uint64_t b)
+    {
+        uint64_t x = a ^ b;
+        uint64_t zero_bytes = ~(((x & ~HIGH_BITS) + ~HIGH_BITS) | x) & HIGH_BITS;
+        return (zero_bytes >> 7) * 0xff;
+    }
+
+    static uint64_t or_i8(uint64_t a, uint64_t b)
+    {
+        return a | b;
+    }
+
+    /** Spread the 8 bits of `mask` out to the low bit of each byte */
+    static uint64_t unmovemask_i8(movemask_t mask)
+    {
+        uint64_t x = mask;
+        x = (x | x << 28) & 0x0000000f0000000f;
+        x = (x | x << 14) & 0x0003000300030003;
+        x = (x | x << 7) & LOW_BITS;
+        return x * 0xff;
+    }
+
+    /**
+     * Gather the high bit of each byte into one byte: bit `8i` (after the
+     * shift) times bit `56 - 7i` of the multiplier lands on bit `56 + i`, and
+     * none of the other partial products reach those bits.
+     */
+    static movemask_t movemask_i8(uint64_t v)
+    {
+        return (movemask_t)((((v & HIGH_BITS) >> 7) * 0x0102040810204080) >> 56);
+    }
+};
 
 template <typename T> struct simd
 {
@@ -82,4 +174,167 @@ template <typename T> struct simd
         T const eqmask = usimd<T>::cmpeq_i8(splat, v);
         return usimd<T>::movemask_i8(eqmask);
     }
-};
\ No newline at end of file
+
+    /**
+     * Set every byte of `v` whose bit is set in `mask` to `0xff`.
+     */
+    static T set_ones(T v, movemask_t mask)
+    {
+        return usimd<T>::or_i8(v, usimd<T>::unmovemask_i8(mask));
+    }
+};
+
+#ifdef __SSE2__
+/**
+ * The instruction sets we have kernels for, each a superset of the one before
+ */
+enum class SimdLevel
+{
+    SSE2,
+    AVX2,
+    AVX512,
+};
+
+/**
+ * Kernels worth building for several instruction sets, picked with cpuid at
+ * startup rather than compiling the whole program for a CPU it might not run
+ * on. Only `rebuild()`'s scan over many ctrl chunks goes through here: a probe
+ * looks at one chunk at a time, which SSE2 already covers in a single compare,
+ * and an indirect call per probe costs more than a wider compare could save.
+ * Batched lookups that want a wider compare (`KeyColumnTbl::get_batch()`)
+ * switch on `level` once per batch instead.
+ */
+struct SimdKernels
+{
+    SimdLevel level;
+    /** `masks[i]` gets a bit for every byte of chunk `i` with its high bit clear */
+    void (*present_chunks)(char const *bytes, size_t nr_chunks, uint16_t *masks);
+};
+
+namespace simd_impl
+{
+inline void present_chunks_sse2(char const *bytes, size_t nr_chunks, uint16_t *masks)
+{
+    for (size_t i = 0; i < nr_chunks; ++i) {
+        masks[i] = ~_mm_movemask_epi8(_mm_loadu_si128((__m128i const *)bytes + i));
+    }
+}
+
+/** A bit for every one of the 16 `keys` (64-byte aligned) that equals `key` */
+inline uint16_t match_u32_group_sse2(uint32_t const *keys, uint32_t key)
+{
+    // Narrow the four compare results down to a byte per key, then take one
+    // movemask of the lot
+    __m128i const needle = _mm_set1_epi32(key);
+    __m128i const *group = (__m128i const *)keys;
+    __m128i eq01 = _mm_packs_epi32(_mm_cmpeq_epi32(_mm_load_si128(group), needle),
+                                   _mm_cmpeq_epi32(_mm_load_si128(group + 1), needle));
+    __m128i eq23 = _mm_packs_epi32(_mm_cmpeq_epi32(_mm_load_si128(group + 2), needle),
+                                   _mm_cmpeq_epi32(_mm_load_si128(group + 3), needle));
+    return _mm_movemask_epi8(_mm_packs_epi16(eq01, eq23));
+}
+
+__attribute__((target("avx2"))) inline void present_chunks_avx2(char const *bytes, size_t nr_chunks,
+                                                                uint16_t *masks)
+{
+    size_t i = 0;
+    for (; i + 2 <= nr_chunks; i += 2) {
+        uint32_t mask = ~_mm256_movemask_epi8(_mm256_loadu_si256((__m256i const *)(bytes + i * 16)));
+        masks[i] = mask;
+        masks[i + 1] = mask >> 16;
+    }
+    present_chunks_sse2(bytes + i * 16, nr_chunks - i, masks + i);
+}
+
+/** `movemask_ps` takes the high bit of each 32-bit lane, so no packing */
+__attribute__((target("avx2"))) inline uint16_t match_u32_group_avx2(uint32_t const *keys,
+                                                                     uint32_t key)
+{
+    __m256i const needle = _mm256_set1_epi32(key);
+    __m256i const *group = (__m256i const *)keys;
+    uint32_t lo = _mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_load_si256(group), needle)));
+    uint32_t hi = _mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_load_si256(group + 1), needle)));
+    return (uint16_t)(lo | hi << 8);
+}
+
+__attribute__((target("avx512bw"))) inline void present_chunks_avx512(char const *bytes,
+                                                                      size_t nr_chunks,
+                                                                      uint16_t *masks)
+{
+    size_t i = 0;
+    for (; i + 4 <= nr_chunks; i += 4) {
+        uint64_t mask = ~_mm512_movepi8_mask(_mm512_loadu_si512(bytes + i * 16));
+        memcpy(masks + i, &mask, sizeof(mask));
+    }
+    present_chunks_sse2(bytes + i * 16, nr_chunks - i, masks + i);
+}
+
+__attribute__((target("avx512f"))) inline uint16_t match_u32_group_avx512(uint32_t const *keys,
+                                                                          uint32_t key)
+{
+    return _mm512_cmpeq_epi32_mask(_mm512_load_si512(keys), _mm512_set1_epi32(key));
+}
+
+/** The active kernels, see `simd_kernels()` */
+inline SimdKernels const *&active();
+} // namespace simd_impl
+
+/**
+ * The best level this CPU supports. SSE2 is part of x86-64, so it's always
+ * there.
+ */
+inline SimdLevel detect_simd_level()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    return SimdLevel::SSE2;
+}
+
+inline bool simd_level_supported(SimdLevel level)
+{
+    return level <= detect_simd_level();
+}
+
+/**
+ * The kernels for `level`, whether or not this CPU can run them.
+ */
+inline SimdKernels const &simd_kernels_for(SimdLevel level)
+{
+    static SimdKernels const kernels[] = {
+        {SimdLevel::SSE2, simd_impl::present_chunks_sse2},
+        {SimdLevel::AVX2, simd_impl::present_chunks_avx2},
+        {SimdLevel::AVX512, simd_impl::present_chunks_avx512},
+    };
+    return kernels[(int)level];
+}
+
+inline SimdKernels const *&simd_impl::active()
+{
+    static SimdKernels const *kernels = &simd_kernels_for(detect_simd_level());
+    return kernels;
+}
+
+/**
+ * The kernels for the best level this CPU supports, picked the first time
+ * they're asked for.
+ */
+inline SimdKernels const &simd_kernels()
+{
+    return *simd_impl::active();
+}
+
+/**
+ * Use the kernels for `level` from now on, for tests and benchmarks. Throws if
+ * this CPU doesn't support `level`.
+ */
+inline void force_simd_level(SimdLevel level)
+{
+    if (!simd_level_supported(level)) {
+        throw std::runtime_error("SIMD level not supported by this CPU");
+    }
+    simd_impl::active() = &simd_kernels_for(level);
+}
+#endif
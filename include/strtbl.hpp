@@ -0,0 +1,247 @@
+#pragma once
+
+#include "hashmap.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * A string key as a `StrTbl` stores it: 16 bytes, holding the length, the
+ * first 4 bytes, and then either the other (up to) 8 bytes, or, for longer
+ * keys, the offset into the table's arena where the whole key is. Unused
+ * inline bytes are zero, so that short keys compare as two words.
+ */
+struct ArenaStr
+{
+    static const size_t INLINE_LEN = 12;
+    static const size_t PREFIX_LEN = 4;
+
+    uint32_t len;
+    char bytes[INLINE_LEN];
+
+    ArenaStr()
+        : len(0)
+        , bytes()
+    {
+    }
+
+    bool is_inline() const
+    {
+        return len <= INLINE_LEN;
+    }
+
+    /** The length and prefix as one word */
+    uint64_t head() const
+    {
+        uint64_t word;
+        memcpy(&word, this, sizeof(uint64_t));
+        return word;
+    }
+
+    /** The inline bytes after the prefix, or the offset, as one word */
+    uint64_t tail() const
+    {
+        uint64_t word;
+        memcpy(&word, bytes + PREFIX_LEN, sizeof(uint64_t));
+        return word;
+    }
+
+    uint64_t offset() const
+    {
+        return tail();
+    }
+
+    void set_offset(uint64_t offset)
+    {
+        memcpy(bytes + PREFIX_LEN, &offset, sizeof(uint64_t));
+    }
+};
+
+/**
+ * A `HashTbl` with string keys, stored as `ArenaStr`s rather than
+ * `std::string`s.
+ *
+ * Keys of up to 12 bytes live entirely in the entry. Longer ones keep their
+ * first 4 bytes in the entry, and all of them in a byte arena shared by the
+ * whole table, so there is no allocation per key. A lookup only goes to the
+ * arena once the cached hash, the length and the prefix all match, which is
+ * almost always the key it's after. Removing keys leaves holes in the arena,
+ * which get compacted away whenever the table grows (or once they're more
+ * than half of it).
+ */
+template <typename Val> class StrTbl
+{
+    /**
+     * An `ArenaStr` means nothing without its table's arena, so it isn't
+     * `is_hashable`. We hash the bytes before they ever become one, and
+     * `HashTbl` never rehashes, so the table never needs to either.
+     */
+    struct ArenaStrHasher
+    {
+        static constexpr bool value = true;
+
+        static size_t hash(ArenaStr const &) = delete;
+    };
+
+public:
+    typedef HashTbl<ArenaStr, Val, LinearProbe, SplitLayout, CopyGrowth, ArenaStrHasher> tbl_t;
+    typedef typename tbl_t::Entry Entry;
+
+private:
+    tbl_t tbl;
+    std::vector<char> arena;
+    /** How many bytes of `arena` no key points at anymore */
+    size_t nr_dead_bytes;
+
+    ArenaStr make_key(std::string_view str)
+    {
+        if (str.size() > std::numeric_limits<uint32_t>::max()) {
+            throw std::runtime_error("key too long");
+        }
+        ArenaStr key;
+        key.len = str.size();
+        if (key.is_inline()) {
+            if (!str.empty()) memcpy(key.bytes, str.data(), str.size());
+        } else {
+            memcpy(key.bytes, str.data(), ArenaStr::PREFIX_LEN);
+            key.set_offset(arena.size());
+            arena.insert(arena.end(), str.begin(), str.end());
+        }
+        return key;
+    }
+
+    bool get_slot(size_t h, std::string_view str, Entry *&slot, char *&ctrl_slot)
+    {
+        // What `str` looks like as an `ArenaStr`, up to where the arena comes
+        // in
+        ArenaStr probe;
+        probe.len = str.size();
+        size_t nr_inline = probe.is_inline() ? str.size() : (size_t)ArenaStr::PREFIX_LEN;
+        if (nr_inline) memcpy(probe.bytes, str.data(), nr_inline);
+        uint64_t head = probe.head();
+        uint64_t tail = probe.tail();
+        bool is_inline = probe.is_inline();
+        char const *arena_data = arena.data();
+        return tbl.get_slot_with(
+            h,
+            [h, head, tail, is_inline, str, arena_data](Entry const &e) {
+                if (e.hash != h || e.key.head() != head) return false;
+                if (is_inline) return e.key.tail() == tail;
+                return memcmp(arena_data + e.key.offset(), str.data(), str.size()) == 0;
+            },
+            slot, ctrl_slot);
+    }
+
+    void release_key(ArenaStr const &key)
+    {
+        if (!key.is_inline()) nr_dead_bytes += key.len;
+    }
+
+    /**
+     * Copy every out-of-line key into a fresh arena, dropping the holes.
+     */
+    void compact_arena()
+    {
+        std::vector<char> packed;
+        packed.reserve(arena.size() - nr_dead_bytes);
+        for (auto kv : tbl) {
+            ArenaStr &key = const_cast<ArenaStr &>(kv.first);
+            if (key.is_inline()) continue;
+            size_t offset = packed.size();
+            char const *data = arena.data() + key.offset();
+            packed.insert(packed.end(), data, data + key.len);
+            key.set_offset(offset);
+        }
+        arena.swap(packed);
+        nr_dead_bytes = 0;
+    }
+
+    void grow()
+    {
+        if (nr_dead_bytes) compact_arena();
+        tbl.grow();
+    }
+
+public:
+    StrTbl()
+        : nr_dead_bytes(0)
+    {
+    }
+
+    /**
+     * Insert a key-value pair, overriding the value if the key already exists.
+     *
+     * # Returns
+     * A pointer to the value
+     */
+    Val *insert(std::string_view key, Val val)
+    {
+        size_t h = is_hashable<std::string_view>::hash(key);
+        Entry *slot;
+        char *ctrl_slot;
+        if (!get_slot(h, key, slot, ctrl_slot)) {
+            slot->val = std::move(val);
+            return &slot->val;
+        }
+        if (tbl.needs_to_grow()) grow();
+        slot = tbl.claim_empty_slot(h);
+        new (slot) Entry(h, make_key(key), std::move(val));
+        return &slot->val;
+    }
+
+    /**
+     * Get a pointer to the value at this key, or `nullptr` if it does not
+     * exist.
+     */
+    Val *get(std::string_view key)
+    {
+        size_t h = is_hashable<std::string_view>::hash(key);
+        Entry *slot;
+        char *ctrl_slot;
+        if (get_slot(h, key, slot, ctrl_slot)) return nullptr;
+        return &slot->val;
+    }
+
+    void remove(std::string_view key)
+    {
+        size_t h = is_hashable<std::string_view>::hash(key);
+        Entry *slot;
+        char *ctrl_slot;
+        if (get_slot(h, key, slot, ctrl_slot)) return;
+        release_key(slot->key);
+        tbl.release_slot(h, ctrl_slot);
+        slot->~Entry();
+        if (nr_dead_bytes > arena.size() / 2) compact_arena();
+    }
+
+    /**
+     * The bytes of a key that's in this table. Valid until the next insert or
+     * remove.
+     */
+    std::string_view key_of(ArenaStr const &key) const
+    {
+        if (key.is_inline()) return std::string_view(key.bytes, key.len);
+        return std::string_view(arena.data() + key.offset(), key.len);
+    }
+
+    /**
+     * Call `f(key, val)` for every entry, with the key as a `std::string_view`.
+     */
+    template <typename F> void for_each(F f)
+    {
+        for (auto kv : tbl) {
+            f(key_of(kv.first), kv.second);
+        }
+    }
+
+    size_t size() const
+    {
+        return tbl.size();
+    }
+
+    /** How many bytes the arena takes up, holes included */
+    size_t arena_size() const
+    {
+        return arena.size();
+    }
+};
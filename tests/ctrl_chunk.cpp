@@ -1,37 +1,128 @@
-// #include "assert.h"
-// #include "hashmap.hpp"
-// #include "simd.hpp"
-// #include <emmintrin.h>
-
-// void ctrlchunk_finds()
-// {
-//     CtrlChunk chunk;
-//     chunk.byte_at(4) = 0xab;
-//     chunk.byte_at(5) = 0xbb;
-//     for (size_t i = 7; i < 16; ++i) {
-//         chunk.byte_at(i) = 0x12;
-//     }
-//     uint32_t out;
-//     ASSERT(chunk.find(0xbb, 0, out) == CtrlChunk::CTRL_FIND_FOUND);
-//     ASSERT(out == 5);
-//     ASSERT(chunk.find(0xbb, 7, out) == CtrlChunk::CTRL_FIND_MAYBE);
-// }
-
-// void movemask_eq_m128i()
-// {
-//     char const N = 0xb2;
-//     __m128i n = _mm_set_epi8(N, ~N, ~N, ~N, N, N, ~N, ~N, N, N, N, ~N, N, N, ~N, ~N);
-//     auto mask = simd<__m128i>::movemask_eq(n, N);
-//     ASSERT(mask == uint16_t(0b1000110011101100u));
-// }
-
-// int main()
-// {
-//     RUNTEST(ctrlchunk_finds);
-//     RUNTEST(movemask_eq_m128i);
-//     return 0;
-// }
-
-int main() {
+#include <hashmap.hpp>
+#include <simd.hpp>
+#include <random>
+#include <vector>
+#include "test.hpp"
+
+#ifdef __SSE2__
+void movemask_eq_m128i()
+{
+    char const N = 0xb2;
+    __m128i n = _mm_set_epi8(N, ~N, ~N, ~N, N, N, ~N, ~N, N, N, N, ~N, N, N, ~N, ~N);
+    auto mask = simd<__m128i>::movemask_eq(n, N);
+    assert_eq(mask, uint16_t(0b1000110011101100u));
+}
+#endif
+
+/** Whichever backend `ctrlchunk_t` is, byte `i` gives bit `i` */
+void movemask_eq_ctrlchunk()
+{
+    char const N = 0xb2;
+    CtrlChunk chunk;
+    ctrlmask_t expected = 0;
+    for (size_t i = 0; i < CtrlChunk::NR_BYTES; ++i) {
+        bool hit = i % 3 == 0 || i == CtrlChunk::NR_BYTES - 1;
+        chunk.byte_at(i) = hit ? N : ~N;
+        if (hit) expected |= (ctrlmask_t)1 << i;
+    }
+    assert_eq(simd<ctrlchunk_t>::movemask_eq(chunk.as_simd(), N), expected);
+}
+
+void ctrlchunk_present_mask()
+{
+    size_t const last = CtrlChunk::NR_BYTES - 1;
+    CtrlChunk chunk;
+    memset(chunk.bytes, CtrlChunk::CTRL_EMPTY, CtrlChunk::NR_BYTES);
+    assert_eq(chunk.present_mask(), 0);
+    chunk.byte_at(1) = 0x2b;
+    chunk.byte_at(2) = 0;
+    chunk.byte_at(3) = CtrlChunk::CTRL_DEL;
+    chunk.byte_at(last) = 0x7f;
+    assert_eq(chunk.present_mask(), (ctrlmask_t)((1 << 1) | (1 << 2) | (1 << last)));
+    chunk.set_empty(1 << 2);
+    assert_eq(chunk.present_mask(), (ctrlmask_t)((1 << 1) | (1 << last)));
+}
+
+void mask_ctz_is_nr_bytes_for_no_bits()
+{
+    ctrlmask_t const high_bit = (ctrlmask_t)1 << (CtrlChunk::NR_BYTES - 1);
+    assert_eq(CtrlChunk::mask_ctz(0), CtrlChunk::NR_BYTES);
+    for (size_t i = 0; i < CtrlChunk::NR_BYTES; ++i) {
+        assert_eq(CtrlChunk::mask_ctz((ctrlmask_t)1 << i), i);
+        assert_eq(CtrlChunk::mask_ctz(high_bit | (ctrlmask_t)1 << i), i);
+    }
+}
+
+// The dispatched kernels work on 16-byte chunks, and only SSE2 chunks go
+// through them
+#if !HASHMAP_CTRLCHUNK_SWAR
+
+/**
+ * Every level this CPU supports has to agree with one chunk at a time, for
+ * every length (so every tail) up to a few vectors' worth.
+ */
+void present_chunks_agrees_with_present_mask()
+{
+    std::mt19937_64 gen(17);
+    size_t const max_nr_chunks = 19;
+    std::vector<CtrlChunk> chunks(max_nr_chunks);
+    for (CtrlChunk &chunk : chunks) {
+        for (size_t i = 0; i < CtrlChunk::NR_BYTES; ++i) {
+            chunk.byte_at(i) = gen() % 4 ? (char)(gen() % 3) : CtrlChunk::CTRL_EMPTY;
+        }
+    }
+    SimdLevel levels[] = {SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512};
+    for (SimdLevel level : levels) {
+        if (!simd_level_supported(level)) {
+            std::cout << "skipping unsupported level " << (int)level << std::endl;
+            continue;
+        }
+        force_simd_level(level);
+        assert(simd_kernels().level == level);
+        for (size_t nr_chunks = 0; nr_chunks <= max_nr_chunks; ++nr_chunks) {
+            std::vector<uint16_t> masks(nr_chunks + 1, 0xabcd);
+            simd_kernels().present_chunks(chunks[0].bytes, nr_chunks, masks.data());
+            for (size_t i = 0; i < nr_chunks; ++i) {
+                assert_eq(masks[i], chunks[i].present_mask());
+            }
+            assert_eq(masks[nr_chunks], 0xabcd);
+        }
+    }
+    force_simd_level(detect_simd_level());
+}
+
+/** `rebuild()` goes through the kernels, so grow a table under each of them */
+void tbl_grows_under_every_level()
+{
+    SimdLevel levels[] = {SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512};
+    for (SimdLevel level : levels) {
+        if (!simd_level_supported(level)) continue;
+        force_simd_level(level);
+        HashTbl<size_t, size_t> tbl;
+        for (size_t i = 0; i < 100000; ++i) {
+            tbl.insert(i * 7, i);
+        }
+        for (size_t i = 0; i < 100000; ++i) {
+            assert_eq(*tbl.get(i * 7), i);
+        }
+        assert_eq(tbl.size(), (size_t)100000);
+    }
+    force_simd_level(detect_simd_level());
+}
+
+#endif
+
+int main()
+{
+#ifdef __SSE2__
+    RUNTEST(movemask_eq_m128i);
+#endif
+    RUNTEST(movemask_eq_ctrlchunk);
+    RUNTEST(ctrlchunk_present_mask);
+    RUNTEST(mask_ctz_is_nr_bytes_for_no_bits);
+#if !HASHMAP_CTRLCHUNK_SWAR
+    RUNTEST(present_chunks_agrees_with_present_mask);
+    RUNTEST(tbl_grows_under_every_level);
+#endif
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,128 @@
+#include <expiringtbl.hpp>
+#include <unordered_map>
+#include <string>
+#include <random>
+#include "test.hpp"
+
+void test_lazy_expiry()
+{
+    ExpiringTbl<std::string, std::string> tbl;
+    tbl.insert("a", "x", 10);
+    tbl.insert("b", "y", 20);
+    assert_eq(*tbl.get("a", 9), "x");
+    assert(tbl.get("a", 10) == nullptr);
+    // The lookup reclaimed it
+    assert_eq(tbl.size(), (size_t)1);
+    assert(tbl.get("a", 0) == nullptr);
+
+    assert(tbl.extend("b", 15, 30));
+    assert_eq(*tbl.get("b", 25), "y");
+    assert(!tbl.extend("b", 30, 40));
+    assert(!tbl.extend("c", 0, 40));
+    assert_eq(tbl.size(), (size_t)0);
+}
+
+void test_wraparound()
+{
+    ExpiringTbl<uint64_t, int> tbl;
+    uint32_t now = 0xfffffff0;
+    tbl.insert(1, 1, now + 0x20);
+    assert_eq(*tbl.get(1, now), 1);
+    assert_eq(*tbl.get(1, now + 0x1f), 1);
+    assert(tbl.get(1, now + 0x20) == nullptr);
+}
+
+void test_sweep_is_bounded_and_wraps()
+{
+    ExpiringTbl<uint64_t, uint64_t> tbl;
+    size_t const n = 10000;
+    for (uint64_t i = 0; i < n; ++i) {
+        tbl.insert(i * 0x9e3779b97f4a7c15, i, i % 2 ? 100 : 50);
+    }
+    size_t nr_ctrlchunks = tbl.nr_ctrlchunks();
+
+    // Nothing has expired yet
+    assert_eq(tbl.sweep(10, nr_ctrlchunks), (size_t)0);
+    assert_eq(tbl.size(), n);
+
+    // A chunk holds at most 16 entries, so a 4 chunk sweep erases at most 64
+    size_t nr_reclaimed = 0;
+    size_t nr_calls = 0;
+    while (nr_reclaimed < n / 2) {
+        size_t r = tbl.sweep(60, 4);
+        assert(r <= 64);
+        nr_reclaimed += r;
+        nr_calls++;
+        assert(nr_calls <= nr_ctrlchunks / 4 + 1);
+    }
+    assert_eq(nr_reclaimed, n / 2);
+    assert_eq(tbl.size(), n / 2);
+
+    // The cursor picks up where it left off and comes back round
+    nr_reclaimed = 0;
+    for (size_t i = 0; i < nr_ctrlchunks / 4 + 1; ++i) {
+        nr_reclaimed += tbl.sweep(100, 4);
+    }
+    assert_eq(nr_reclaimed, n / 2);
+    assert_eq(tbl.size(), (size_t)0);
+}
+
+void test_against_oracle()
+{
+    ExpiringTbl<uint64_t, uint64_t> tbl;
+    std::unordered_map<uint64_t, std::pair<uint64_t, uint32_t>> oraclemap;
+    std::mt19937_64 gen(5);
+    std::uniform_int_distribution<uint64_t> key_dis(0, 1 << 14);
+    std::uniform_int_distribution<uint32_t> ttl_dis(1, 200);
+
+    for (uint32_t now = 0; now < 2000; ++now) {
+        for (size_t i = 0; i < 50; ++i) {
+            uint64_t k = key_dis(gen);
+            uint32_t expires_at = now + ttl_dis(gen);
+            tbl.insert(k, k + now, expires_at);
+            oraclemap[k] = std::make_pair(k + now, expires_at);
+        }
+        for (size_t i = 0; i < 50; ++i) {
+            uint64_t k = key_dis(gen);
+            uint64_t *val = tbl.get(k, now);
+            auto it = oraclemap.find(k);
+            if (it == oraclemap.end() || it->second.second <= now) {
+                assert(val == nullptr);
+            } else {
+                assert(val != nullptr);
+                assert_eq(*val, it->second.first);
+            }
+        }
+        tbl.sweep(now, 8);
+    }
+    // A full lap reclaims everything that has expired, and nothing else
+    uint32_t now = 2000;
+    tbl.sweep(now, tbl.nr_ctrlchunks());
+    tbl.sweep(now, tbl.nr_ctrlchunks());
+    size_t nr_live = 0;
+    for (auto kv : oraclemap) {
+        if (kv.second.second > now) nr_live++;
+    }
+    assert_eq(tbl.size(), nr_live);
+}
+
+void test_short_keys()
+{
+    ExpiringTbl<uint16_t, int> tbl;
+    tbl.insert(0xffff, 1, 10);
+    tbl.insert(2, 2, 20);
+    assert_eq(*tbl.get(0xffff, 5), 1);
+    assert(tbl.get(0xffff, 10) == nullptr);
+    assert_eq(*tbl.get(2, 15), 2);
+    assert_eq(tbl.size(), (size_t)1);
+}
+
+int main()
+{
+    RUNTEST(test_lazy_expiry);
+    RUNTEST(test_wraparound);
+    RUNTEST(test_sweep_is_bounded_and_wraps);
+    RUNTEST(test_against_oracle);
+    RUNTEST(test_short_keys);
+    return 0;
+}
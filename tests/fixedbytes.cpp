@@ -0,0 +1,85 @@
+#include <fixedbytes.hpp>
+#include <unordered_map>
+#include <string>
+#include <random>
+#include "test.hpp"
+
+template <size_t N> void test_equality_looks_at_every_byte()
+{
+    uint8_t raw[N];
+    for (size_t i = 0; i < N; ++i) {
+        raw[i] = i;
+    }
+    typedef is_hashable<FixedBytes<N>> hasher;
+    FixedBytes<N> key(raw);
+    assert_eq(memcmp(key.bytes, raw, N), 0);
+    for (size_t i = N; i < FixedBytes<N>::STORAGE_LEN; ++i) {
+        assert_eq(key.bytes[i], 0);
+    }
+    assert(key == FixedBytes<N>(raw));
+    assert_eq(hasher::hash(key), hasher::hash(FixedBytes<N>(raw)));
+    for (size_t i = 0; i < N; ++i) {
+        raw[i] ^= 0x80;
+        assert(key != FixedBytes<N>(raw));
+        assert(hasher::hash(key) != hasher::hash(FixedBytes<N>(raw)));
+        raw[i] ^= 0x80;
+    }
+}
+
+/** Key a `HashTbl` on 5-tuple-like keys, most of whose bytes are the same */
+template <size_t N> void test_tbl_against_oracle()
+{
+    HashTbl<FixedBytes<N>, size_t> tbl;
+    std::unordered_map<std::string, size_t> oraclemap;
+    std::mt19937_64 gen(37);
+    std::uniform_int_distribution<uint32_t> dis(0, 1 << 16);
+    std::uniform_int_distribution<int> op_dis(0, 2);
+
+    for (size_t i = 0; i < 200000; ++i) {
+        uint8_t raw[N] = {10, 0, 0, 1};
+        uint32_t port = dis(gen);
+        memcpy(raw + N - sizeof(port), &port, sizeof(port));
+        FixedBytes<N> key(raw);
+        std::string oraclekey((char *)raw, N);
+        switch (op_dis(gen)) {
+        case 0:
+            tbl.insert(key, i);
+            oraclemap[oraclekey] = i;
+            break;
+        case 1:
+            tbl.remove(key);
+            oraclemap.erase(oraclekey);
+            break;
+        case 2: {
+            size_t *val = tbl.get(key);
+            auto it = oraclemap.find(oraclekey);
+            if (it == oraclemap.end()) {
+                assert(val == nullptr);
+            } else {
+                assert_eq(*val, it->second);
+            }
+            break;
+        }
+        }
+    }
+    assert_eq(tbl.size(), oraclemap.size());
+}
+
+int main()
+{
+    RUNTEST(test_equality_looks_at_every_byte<1>);
+    RUNTEST(test_equality_looks_at_every_byte<3>);
+    RUNTEST(test_equality_looks_at_every_byte<4>);
+    RUNTEST(test_equality_looks_at_every_byte<6>);
+    RUNTEST(test_equality_looks_at_every_byte<8>);
+    RUNTEST(test_equality_looks_at_every_byte<9>);
+    RUNTEST(test_equality_looks_at_every_byte<13>);
+    RUNTEST(test_equality_looks_at_every_byte<16>);
+    RUNTEST(test_equality_looks_at_every_byte<20>);
+    RUNTEST(test_equality_looks_at_every_byte<32>);
+    RUNTEST(test_equality_looks_at_every_byte<40>);
+    RUNTEST(test_tbl_against_oracle<13>);
+    RUNTEST(test_tbl_against_oracle<16>);
+    RUNTEST(test_tbl_against_oracle<32>);
+    return 0;
+}
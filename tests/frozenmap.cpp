@@ -0,0 +1,129 @@
+#include <frozenmap.hpp>
+#include "test.hpp"
+
+typedef int (*handler_t)(int, int);
+
+int op_add(int a, int b)
+{
+    return a + b;
+}
+
+int op_sub(int a, int b)
+{
+    return a - b;
+}
+
+int op_mul(int a, int b)
+{
+    return a * b;
+}
+
+int op_and(int a, int b)
+{
+    return a & b;
+}
+
+static constexpr std::pair<uint8_t, handler_t> OPCODE_LIST[] = {
+    {0x01, &op_add}, {0x02, &op_sub}, {0x03, &op_mul}, {0x10, &op_and}, {0xff, &op_add},
+};
+static constexpr auto OPCODES = make_frozen_map(OPCODE_LIST);
+
+enum class Header
+{
+    Accept,
+    ContentLength,
+    ContentType,
+    Host,
+    UserAgent,
+    XForwardedFor,
+};
+
+static constexpr std::pair<std::string_view, Header> HEADER_LIST[] = {
+    {"accept", Header::Accept},
+    {"content-length", Header::ContentLength},
+    {"content-type", Header::ContentType},
+    {"host", Header::Host},
+    {"user-agent", Header::UserAgent},
+    {"x-forwarded-for", Header::XForwardedFor},
+};
+static constexpr auto HEADERS = make_frozen_map(HEADER_LIST);
+
+// Both were built by the compiler
+static_assert(OPCODES.size() == 5, "");
+static_assert(HEADERS.hash_seed() < FrozenMap<std::string_view, Header, 6>::MAX_SEEDS, "");
+
+/** Enough keys to need more than a handful of ctrl chunks */
+struct ManyKeys
+{
+    static const size_t N = 1000;
+
+    std::pair<uint32_t, uint32_t> items[N];
+
+    constexpr ManyKeys()
+        : items()
+    {
+        for (size_t i = 0; i < N; ++i) {
+            items[i].first = (uint32_t)(i * 2654435761u);
+            items[i].second = (uint32_t)i;
+        }
+    }
+};
+
+static constexpr ManyKeys MANY_KEYS;
+static constexpr FrozenMap<uint32_t, uint32_t, ManyKeys::N> MANY(MANY_KEYS.items);
+
+void test_opcodes_against_hashtbl()
+{
+    HashTbl<uint8_t, handler_t> tbl;
+    for (auto const &kv : OPCODE_LIST) {
+        tbl.insert(kv.first, kv.second);
+    }
+    for (size_t op = 0; op < 256; ++op) {
+        handler_t const *frozen = OPCODES.get(op);
+        handler_t *v = tbl.get(op);
+        assert_eq(frozen == nullptr, v == nullptr);
+        if (frozen) assert(*frozen == *v);
+    }
+    assert_eq((*OPCODES.get(0x03))(6, 7), 42);
+}
+
+void test_headers_against_hashtbl()
+{
+    HashTbl<std::string_view, Header> tbl;
+    for (auto const &kv : HEADER_LIST) {
+        tbl.insert(kv.first, kv.second);
+    }
+    char const *lookups[] = {
+        "accept", "content-length", "content-type", "host", "user-agent", "x-forwarded-for",
+        "",       "Accept",         "content",      "hos",  "hosts",      "x-forwarded-fo",
+    };
+    for (char const *name : lookups) {
+        Header const *frozen = HEADERS.get(name);
+        Header *v = tbl.get(name);
+        assert_eq(frozen == nullptr, v == nullptr);
+        if (frozen) assert(*frozen == *v);
+    }
+}
+
+void test_many_keys_against_hashtbl()
+{
+    HashTbl<uint32_t, uint32_t> tbl;
+    for (auto const &kv : MANY_KEYS.items) {
+        tbl.insert(kv.first, kv.second);
+    }
+    for (auto const &kv : MANY_KEYS.items) {
+        assert_eq(*MANY.get(kv.first), *tbl.get(kv.first));
+        // and some keys that aren't there
+        assert_eq(MANY.get(kv.first + 1) == nullptr, tbl.get(kv.first + 1) == nullptr);
+    }
+    for (uint32_t k = 0; k < (1 << 16); ++k) {
+        assert_eq(MANY.get(k) == nullptr, tbl.get(k) == nullptr);
+    }
+}
+
+int main()
+{
+    RUNTEST(test_opcodes_against_hashtbl);
+    RUNTEST(test_headers_against_hashtbl);
+    RUNTEST(test_many_keys_against_hashtbl);
+}
@@ -0,0 +1,84 @@
+#include <groupby.hpp>
+#include <unordered_map>
+#include <algorithm>
+#include <vector>
+#include <random>
+#include "test.hpp"
+
+void test_sum_and_count_against_oracle()
+{
+    size_t const nr_rows = 1 << 20;
+    std::vector<uint64_t> keys;
+    std::vector<int64_t> vals;
+    std::mt19937_64 gen(3);
+    std::uniform_int_distribution<uint64_t> key_dis(0, 1 << 14);
+    std::uniform_int_distribution<int64_t> val_dis(-1000, 1000);
+    for (size_t i = 0; i < nr_rows; ++i) {
+        keys.push_back(key_dis(gen) * 0x9e3779b97f4a7c15);
+        vals.push_back(val_dis(gen));
+    }
+
+    GroupBy<uint64_t, int64_t> sums;
+    GroupBy<uint64_t, int64_t, CountAgg<int64_t>> counts;
+    std::unordered_map<uint64_t, std::pair<int64_t, size_t>> oraclemap;
+    // Uneven chunks, so that batches don't line up with the calls
+    for (size_t start = 0; start < nr_rows; start += 1000) {
+        size_t n = std::min((size_t)1000, nr_rows - start);
+        sums.ingest(&keys[start], &vals[start], n);
+        counts.ingest(&keys[start], &vals[start], n);
+    }
+    for (size_t i = 0; i < nr_rows; ++i) {
+        oraclemap[keys[i]].first += vals[i];
+        oraclemap[keys[i]].second++;
+    }
+
+    assert_eq(sums.size(), oraclemap.size());
+    assert_eq(counts.size(), oraclemap.size());
+    size_t nr_emitted = 0;
+    sums.emit([&](uint64_t const &k, int64_t const &sum) {
+        assert_eq(sum, oraclemap[k].first);
+        nr_emitted++;
+    });
+    assert_eq(nr_emitted, oraclemap.size());
+    for (auto kv : oraclemap) {
+        assert_eq(*counts.get(kv.first), kv.second.second);
+    }
+}
+
+void test_min_max()
+{
+    uint32_t keys[] = {1, 2, 1, 3, 2, 1};
+    int vals[] = {5, -1, 2, 7, 4, 9};
+    GroupBy<uint32_t, int, MinAgg<int>> mins;
+    GroupBy<uint32_t, int, MaxAgg<int>> maxs;
+    mins.ingest(keys, vals, 6);
+    maxs.ingest(keys, vals, 6);
+    assert_eq(*mins.get(1), 2);
+    assert_eq(*mins.get(2), -1);
+    assert_eq(*mins.get(3), 7);
+    assert_eq(*maxs.get(1), 9);
+    assert_eq(*maxs.get(2), 4);
+    assert(mins.get(4) == nullptr);
+}
+
+/** Small integer keys go through the same hashed table as any other */
+void test_byte_keys()
+{
+    uint8_t keys[] = {0, 255, 0, 7, 255, 0};
+    int vals[] = {1, 2, 3, 4, 5, 6};
+    GroupBy<uint8_t, int> sums;
+    sums.ingest(keys, vals, 6);
+    assert_eq(sums.size(), (size_t)3);
+    assert_eq(*sums.get(0), 10);
+    assert_eq(*sums.get(7), 4);
+    assert_eq(*sums.get(255), 7);
+    assert(sums.get(1) == nullptr);
+}
+
+int main()
+{
+    RUNTEST(test_sum_and_count_against_oracle);
+    RUNTEST(test_min_max);
+    RUNTEST(test_byte_keys);
+    return 0;
+}
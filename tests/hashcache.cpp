@@ -0,0 +1,89 @@
+#include <hashcache.hpp>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <random>
+#include "test.hpp"
+
+void test_stays_within_capacity()
+{
+    HashCache<size_t, size_t> cache(1 << 16);
+    std::unordered_map<size_t, size_t> oraclemap;
+    std::mt19937_64 gen(5);
+    std::uniform_int_distribution<size_t> dis(0, cache.capacity() * 8);
+    for (size_t i = 0; i < (1 << 18); ++i) {
+        size_t k = dis(gen);
+        size_t *v = cache.get(k);
+        // Anything still cached has the value we last put
+        if (v) assert_eq(*v, oraclemap[k]);
+        cache.put(k, i);
+        oraclemap[k] = i;
+        assert(cache.size() <= cache.capacity());
+        assert_eq(*cache.get(k), i);
+    }
+    // Keys land in their home ctrl chunk or not at all, so not every slot
+    // ends up used
+    assert(cache.size() > cache.capacity() / 4 * 3);
+}
+
+void test_referenced_entries_get_a_second_chance()
+{
+    HashCache<size_t, size_t> cache(1 << 16);
+    size_t cap = cache.capacity();
+    // Consecutive integers fill every ctrl chunk exactly
+    for (size_t k = 0; k < cap; ++k) {
+        cache.put(k, k);
+    }
+    for (size_t k = 0; k < cap; k += 2) {
+        assert(cache.get(k) != nullptr);
+    }
+    // Half a chunk's worth of new keys for every ctrl chunk
+    for (size_t k = 1; k < cap; k += 2) {
+        cache.put(cap + k, k);
+    }
+    assert_eq(cache.get_stats().evictions, cap / 2);
+    for (size_t k = 0; k < cap; k += 2) {
+        assert(cache.get(k) != nullptr);
+    }
+}
+
+void test_stats_and_removes()
+{
+    HashCache<std::string, std::string> cache(1 << 12);
+    assert(cache.get("a") == nullptr);
+    cache.put("a", "apple");
+    cache.put("b", "banana");
+    assert_eq(*cache.get("a"), std::string("apple"));
+    assert_eq(*cache.get("b"), std::string("banana"));
+    cache.remove("a");
+    assert(cache.get("a") == nullptr);
+    assert_eq(cache.size(), (size_t)1);
+    assert_eq(cache.get_stats().hits, (size_t)2);
+    assert_eq(cache.get_stats().misses, (size_t)2);
+    assert_eq(cache.get_stats().hit_rate(), 0.5);
+    cache.reset_stats();
+    assert_eq(cache.get_stats().hits + cache.get_stats().misses, (size_t)0);
+    for (size_t i = 0; i < 10 * cache.capacity(); ++i) {
+        cache.put("key number " + std::to_string(i), "val number " + std::to_string(i));
+    }
+    assert(cache.size() <= cache.capacity());
+}
+
+void test_byte_keys()
+{
+    HashCache<uint8_t, int> cache(1 << 10);
+    for (int i = 0; i < 256; ++i) {
+        cache.put((uint8_t)i, i);
+        assert(cache.size() <= cache.capacity());
+        assert_eq(*cache.get((uint8_t)i), i);
+    }
+}
+
+int main()
+{
+    RUNTEST(test_stays_within_capacity);
+    RUNTEST(test_referenced_entries_get_a_second_chance);
+    RUNTEST(test_stats_and_removes);
+    RUNTEST(test_byte_keys);
+    return 0;
+}
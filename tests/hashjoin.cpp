@@ -0,0 +1,137 @@
+#include <hashjoin.hpp>
+#include <unordered_map>
+#include <algorithm>
+#include <vector>
+#include <random>
+#include "test.hpp"
+
+/**
+ * Join a build side with duplicate keys against a probe side where only some
+ * rows match, and check we get exactly the pairs that a
+ * `std::unordered_multimap` join gives.
+ */
+template <size_t RADIX_BITS, size_t NR_THREADS> void test_join_against_oracle()
+{
+    size_t const nr_build = 200000;
+    size_t const nr_probe = 300000;
+    std::mt19937_64 gen(RADIX_BITS);
+    std::uniform_int_distribution<uint64_t> dis(0, nr_build / 2);
+    std::vector<uint64_t> build_keys, probe_keys;
+    std::vector<uint32_t> build_rows, probe_rows;
+    for (uint32_t i = 0; i < nr_build; ++i) {
+        build_keys.push_back(dis(gen));
+        build_rows.push_back(i);
+    }
+    for (uint32_t i = 0; i < nr_probe; ++i) {
+        probe_keys.push_back(dis(gen) * 2);
+        probe_rows.push_back(i);
+    }
+
+    HashJoin<uint64_t, uint32_t> join(RADIX_BITS, NR_THREADS);
+    join.build(build_keys.data(), build_rows.data(), nr_build);
+    if (RADIX_BITS != HashJoin<uint64_t, uint32_t>::AUTO_RADIX_BITS) {
+        assert_eq(join.nr_partitions(), (size_t)1 << RADIX_BITS);
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    size_t nr_matches =
+        join.probe(probe_keys.data(), probe_rows.data(), nr_probe,
+                   [&pairs](uint32_t b, uint32_t p) { pairs.push_back(std::make_pair(b, p)); });
+    assert_eq(nr_matches, pairs.size());
+
+    std::unordered_multimap<uint64_t, uint32_t> oraclemap;
+    for (size_t i = 0; i < nr_build; ++i) {
+        oraclemap.insert(std::make_pair(build_keys[i], build_rows[i]));
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> oracle_pairs;
+    for (size_t i = 0; i < nr_probe; ++i) {
+        auto range = oraclemap.equal_range(probe_keys[i]);
+        for (auto it = range.first; it != range.second; ++it) {
+            oracle_pairs.push_back(std::make_pair(it->second, probe_rows[i]));
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+    std::sort(oracle_pairs.begin(), oracle_pairs.end());
+    assert_eq(pairs.size(), oracle_pairs.size());
+    assert(pairs == oracle_pairs);
+}
+
+void test_empty_sides()
+{
+    HashJoin<uint64_t, uint32_t> join;
+    uint64_t key = 1;
+    uint32_t row = 0;
+    auto fail = [](uint32_t, uint32_t) { assert(false); };
+    assert_eq(join.probe(&key, &row, 1, fail), (size_t)0);
+    join.build(nullptr, nullptr, 0);
+    assert_eq(join.probe(&key, &row, 1, fail), (size_t)0);
+    join.build(&key, &row, 1);
+    assert_eq(join.probe(nullptr, nullptr, 0, fail), (size_t)0);
+}
+
+/** A key that throws when a duplicate of 13 gets compared, i.e. in a worker */
+struct ThrowingKey
+{
+    uint64_t v;
+
+    bool operator==(ThrowingKey const &other) const
+    {
+        if (v == 13) throw std::runtime_error("bad key");
+        return v == other.v;
+    }
+};
+
+template <> struct is_hashable<ThrowingKey>
+{
+    static constexpr bool value = true;
+
+    static size_t hash(ThrowingKey const &key)
+    {
+        return key.v;
+    }
+};
+
+void test_worker_exceptions_reach_the_caller()
+{
+    std::vector<ThrowingKey> keys;
+    std::vector<uint32_t> rows;
+    for (uint32_t i = 0; i < 10000; ++i) {
+        keys.push_back(ThrowingKey{i % 5000});
+        rows.push_back(i);
+    }
+    HashJoin<ThrowingKey, uint32_t> join(4, 4);
+    bool thrown = false;
+    try {
+        join.build(keys.data(), rows.data(), keys.size());
+    } catch (std::runtime_error const &) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void test_short_keys()
+{
+    uint16_t build_keys[] = {1, 0xffff, 1};
+    uint32_t build_rows[] = {10, 11, 12};
+    uint16_t probe_keys[] = {1, 2, 0xffff};
+    uint32_t probe_rows[] = {20, 21, 22};
+    HashJoin<uint16_t, uint32_t> join;
+    join.build(build_keys, build_rows, 3);
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    join.probe(probe_keys, probe_rows, 3,
+               [&pairs](uint32_t b, uint32_t p) { pairs.push_back(std::make_pair(b, p)); });
+    std::sort(pairs.begin(), pairs.end());
+    std::vector<std::pair<uint32_t, uint32_t>> expected = {{10, 20}, {11, 22}, {12, 20}};
+    assert(pairs == expected);
+}
+
+int main()
+{
+    RUNTEST((test_join_against_oracle<0, 1>));
+    RUNTEST((test_join_against_oracle<4, 1>));
+    RUNTEST((test_join_against_oracle<4, 4>));
+    RUNTEST((test_join_against_oracle<HashJoin<uint64_t, uint32_t>::AUTO_RADIX_BITS, 0>));
+    RUNTEST(test_empty_sides);
+    RUNTEST(test_worker_exceptions_reach_the_caller);
+    RUNTEST(test_short_keys);
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <hashmultitbl.hpp>
+#include <unordered_map>
+#include <string>
+#include <vector>
+#include <random>
+#include "test.hpp"
+
+void test_runs_keep_insertion_order()
+{
+    HashMultiTbl<std::string, std::string> tbl;
+    tbl.insert("a", "1");
+    tbl.insert("b", "2");
+    tbl.insert("a", "3");
+    tbl.insert("a", "4");
+    assert_eq(tbl.count("a"), (size_t)3);
+    assert_eq(tbl.count("b"), (size_t)1);
+    assert_eq(tbl.count("c"), (size_t)0);
+    assert_eq(tbl.size(), (size_t)4);
+    assert_eq(tbl.nr_keys(), (size_t)2);
+
+    auto range = tbl.equal_range("a");
+    assert_eq(range.second - range.first, 3);
+    assert_eq(range.first[0], "1");
+    assert_eq(range.first[1], "3");
+    assert_eq(range.first[2], "4");
+    range = tbl.equal_range("c");
+    assert(range.first == range.second);
+
+    tbl.remove("a");
+    assert_eq(tbl.count("a"), (size_t)0);
+    assert_eq(tbl.size(), (size_t)1);
+    assert_eq(*tbl.equal_range("b").first, "2");
+}
+
+void test_against_oracle()
+{
+    HashMultiTbl<uint64_t, uint64_t> tbl;
+    std::unordered_map<uint64_t, std::vector<uint64_t>> oraclemap;
+    std::mt19937_64 gen(11);
+    std::uniform_int_distribution<uint64_t> key_dis(0, 1 << 12);
+    for (size_t round = 0; round < 200; ++round) {
+        std::uniform_int_distribution<int> op_dis(0, 9);
+        int op = op_dis(gen);
+        if (op < 4) {
+            for (size_t i = 0; i < 100; ++i) {
+                uint64_t k = key_dis(gen);
+                uint64_t v = gen();
+                tbl.insert(k, v);
+                oraclemap[k].push_back(v);
+            }
+        } else if (op < 8) {
+            // Batches with lots of repeats, both of each other and of keys
+            // that are already there
+            std::vector<uint64_t> keys, vals;
+            for (size_t i = 0; i < 500; ++i) {
+                keys.push_back(key_dis(gen) % 300);
+                vals.push_back(gen());
+            }
+            tbl.insert_batch(keys.data(), vals.data(), keys.size());
+            for (size_t i = 0; i < keys.size(); ++i) {
+                oraclemap[keys[i]].push_back(vals[i]);
+            }
+        } else {
+            for (size_t i = 0; i < 100; ++i) {
+                uint64_t k = key_dis(gen);
+                tbl.remove(k);
+                oraclemap.erase(k);
+            }
+        }
+
+        size_t nr_vals = 0;
+        for (auto &kv : oraclemap) {
+            nr_vals += kv.second.size();
+        }
+        assert_eq(tbl.size(), nr_vals);
+        assert_eq(tbl.nr_keys(), oraclemap.size());
+    }
+
+    for (uint64_t k = 0; k <= 1 << 12; ++k) {
+        auto it = oraclemap.find(k);
+        auto range = tbl.equal_range(k);
+        if (it == oraclemap.end()) {
+            assert_eq(tbl.count(k), (size_t)0);
+            continue;
+        }
+        assert_eq(tbl.count(k), it->second.size());
+        assert_eq((size_t)(range.second - range.first), it->second.size());
+        for (size_t i = 0; i < it->second.size(); ++i) {
+            assert_eq(range.first[i], it->second[i]);
+        }
+    }
+}
+
+void test_short_keys()
+{
+    HashMultiTbl<uint16_t, int> tbl;
+    tbl.insert(0xffff, 1);
+    tbl.insert(3, 2);
+    tbl.insert(0xffff, 3);
+    assert_eq(tbl.count(0xffff), (size_t)2);
+    assert_eq(tbl.count(3), (size_t)1);
+    assert_eq(tbl.count(4), (size_t)0);
+    auto range = tbl.equal_range(0xffff);
+    assert_eq(range.first[0], 1);
+    assert_eq(range.first[1], 3);
+}
+
+int main()
+{
+    RUNTEST(test_runs_keep_insertion_order);
+    RUNTEST(test_against_oracle);
+    RUNTEST(test_short_keys);
+    return 0;
+}
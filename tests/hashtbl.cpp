@@ -1,26 +1,10 @@
 #include <hashmap.hpp>
 #include <ihashmap.hpp>
 #include <unordered_map>
-#include <cassert>
-
-#define RUNTEST(fn)                                                    \
-    ({                                                                 \
-        std::cout << "\033[1;34m  start:\033[0m " << #fn << std::endl; \
-        auto f = fn;                                                   \
-        f();                                                           \
-        std::cout << "\033[1;32msuccess:\033[0m " << #fn << std::endl; \
-        0;                                                             \
-    })
-
-#define assert_eq(aexpr, bexpr)                         \
-    ({                                                  \
-        auto a = aexpr;                                 \
-        auto b = bexpr;                                 \
-        if (a != b) {                                   \
-            std::cout << a << " != " << b << std::endl; \
-            assert(a == b);                             \
-        }                                               \
-    })
+#include <map>
+#include <algorithm>
+#include <memory>
+#include "test.hpp"
 
 static std::vector<size_t> MAP_TEST_DATA;
 
@@ -174,6 +158,534 @@ struct test_suite
     }
 };
 
+void test_iter_after_mass_removes()
+{
+    HashTbl<size_t, size_t> tbl;
+    default_std_unordered_map_t<size_t, size_t> oraclemap;
+    for (size_t i = 0; i < (1 << 16); ++i) {
+        tbl.insert(i * 7, i);
+        oraclemap[i * 7] = i;
+    }
+    // Leave big runs of empty chunks, with the odd survivor in between
+    for (size_t i = 0; i < (1 << 16); ++i) {
+        if (i % 1000 == 0) continue;
+        tbl.remove(i * 7);
+        oraclemap.erase(i * 7);
+    }
+    size_t nr_seen = 0;
+    for (auto kv : tbl) {
+        assert_eq(oraclemap.at(kv.first), kv.second);
+        nr_seen++;
+    }
+    assert_eq(nr_seen, oraclemap.size());
+    for (auto kv : oraclemap) {
+        tbl.remove(kv.first);
+    }
+    assert(tbl.begin() == tbl.end());
+}
+
+void test_erase_if_against_oracle()
+{
+    HashTbl<int, int> tbl;
+    default_std_unordered_map_t<int, int> oraclemap;
+    std::mt19937_64 gen(0);
+    for (size_t i = 0; i < (1 << 16); ++i) {
+        int k = gen() % (1 << 18);
+        tbl.insert(k, k % 10);
+        oraclemap[k] = k % 10;
+    }
+    size_t nr_erased = tbl.erase_if([](int const &, int &v) { return v < 3; });
+    size_t nr_oracle_erased = 0;
+    for (auto it = oraclemap.begin(); it != oraclemap.end();) {
+        if (it->second < 3) {
+            it = oraclemap.erase(it);
+            nr_oracle_erased++;
+        } else {
+            ++it;
+        }
+    }
+    assert_eq(nr_erased, nr_oracle_erased);
+    assert_eq(tbl.size(), oraclemap.size());
+    size_t nr_odd = 0;
+    for (auto kv : oraclemap) {
+        nr_odd += kv.first % 2;
+    }
+    nr_erased = tbl.retain([](int const &k, int &) { return k % 2 == 0; });
+    assert_eq(nr_erased, nr_odd);
+    for (int k = 0; k < (1 << 18); ++k) {
+        auto oraclev = oraclemap.find(k);
+        bool expected = oraclev != oraclemap.end() && k % 2 == 0;
+        int *testv = tbl.get(k);
+        assert((testv != nullptr) == expected);
+        if (testv) assert_eq(*testv, oraclev->second);
+    }
+    // The table is still usable afterwards, including for keys that overflowed
+    for (int k = 0; k < (1 << 18); ++k) {
+        tbl.insert(k, k);
+    }
+    for (int k = 0; k < (1 << 18); ++k) {
+        assert_eq(*tbl.get(k), k);
+    }
+}
+
+void test_extract_and_reinsert_nodes()
+{
+    HashTbl<std::string, std::string> hot;
+    HashTbl<std::string, std::string> cold;
+    for (size_t i = 0; i < 1000; ++i) {
+        hot.insert("key number " + std::to_string(i), "val number " + std::to_string(i));
+    }
+    assert(hot.extract("not a key").empty());
+    for (size_t i = 0; i < 1000; i += 2) {
+        auto node = hot.extract("key number " + std::to_string(i));
+        assert(!node.empty());
+        assert_eq(node.hash(), is_hashable<std::string>::hash(node.key()));
+        cold.insert(std::move(node));
+        assert(node.empty());
+    }
+    assert_eq(hot.size(), (size_t)500);
+    assert_eq(cold.size(), (size_t)500);
+    for (size_t i = 0; i < 1000; ++i) {
+        std::string k = "key number " + std::to_string(i);
+        std::string *v = (i % 2 ? hot : cold).get(k);
+        assert(v != nullptr);
+        assert_eq(*v, "val number " + std::to_string(i));
+        assert((i % 2 ? cold : hot).get(k) == nullptr);
+    }
+    // Reinserting over an existing key overrides its value
+    hot.insert("key number 0", "stale");
+    auto node = cold.extract("key number 0");
+    assert_eq(*hot.insert(std::move(node)), std::string("val number 0"));
+    assert_eq(hot.size(), (size_t)501);
+}
+
+void test_hashed_ops_across_tables()
+{
+    // Hash each key once and use it for two tables
+    HashTbl<std::string, size_t> lens;
+    HashTbl<std::string, size_t> idxs;
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < 1000; ++i) {
+        keys.push_back("key" + std::to_string(i));
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+        size_t h = is_hashable<std::string>::hash(keys[i]);
+        lens.insert_hashed(h, keys[i], keys[i].size());
+        idxs.insert_hashed(h, keys[i], i);
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+        size_t h = is_hashable<std::string>::hash(keys[i]);
+        assert_eq(*lens.find_hashed(h, keys[i]), keys[i].size());
+        assert_eq(*idxs.find_hashed(h, keys[i]), i);
+        // and the hashed and unhashed operations agree, const or not
+        assert_eq(*idxs.get(keys[i]), i);
+        HashTbl<std::string, size_t> const &const_idxs = idxs;
+        assert_eq(*const_idxs.get(keys[i]), i);
+        assert_eq(*const_idxs.find_hashed(h, keys[i]), i);
+        if (i % 2) idxs.remove_hashed(h, keys[i]);
+    }
+    assert_eq(idxs.size(), keys.size() / 2);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        size_t h = is_hashable<std::string>::hash(keys[i]);
+        assert((idxs.find_hashed(h, keys[i]) == nullptr) == (i % 2 == 1));
+    }
+
+    DirectTbl<unsigned char, size_t> direct;
+    direct.insert_hashed(is_hashable<unsigned char>::hash(7), 7, 1);
+    assert_eq(*direct.find_hashed(is_hashable<unsigned char>::hash(7), 7), (size_t)1);
+    DirectTbl<unsigned char, size_t> const &const_direct = direct;
+    assert_eq(*const_direct.get(7), (size_t)1);
+    direct.remove_hashed(is_hashable<unsigned char>::hash(7), 7);
+    assert(direct.get(7) == nullptr);
+}
+
+void test_upsert_against_oracle()
+{
+    HashTbl<size_t, size_t> counts;
+    default_std_unordered_map_t<size_t, size_t> oraclemap;
+    std::mt19937_64 gen(11);
+    std::uniform_int_distribution<size_t> dis(0, 1 << 12);
+    for (size_t i = 0; i < (1 << 18); ++i) {
+        size_t k = dis(gen);
+        size_t *v = counts.upsert(k, 1, [](size_t &v) { v++; });
+        assert_eq(*v, ++oraclemap[k]);
+    }
+    assert_eq(counts.size(), oraclemap.size());
+    for (auto kv : oraclemap) {
+        assert_eq(*counts.get(kv.first), kv.second);
+    }
+
+    HashTbl<std::string, std::string> words;
+    words.upsert("a", "x", [](std::string &v) { v += "y"; });
+    words.upsert("a", "x", [](std::string &v) { v += "y"; });
+    words.upsert("b", "x", [](std::string &v) { v += "y"; });
+    assert_eq(*words.get("a"), std::string("xy"));
+    assert_eq(*words.get("b"), std::string("x"));
+}
+
+void test_merge_against_oracle()
+{
+    std::mt19937_64 gen(7);
+    std::uniform_int_distribution<size_t> dis(0, 1 << 14);
+    HashTbl<size_t, size_t> merged;
+    default_std_unordered_map_t<size_t, size_t> oraclemap;
+    // Partial tables of varying sizes with plenty of keys in common
+    for (size_t part = 0; part < 8; ++part) {
+        HashTbl<size_t, size_t> partial;
+        for (size_t i = 0; i < (1000u << part); ++i) {
+            size_t k = dis(gen);
+            size_t *v = partial.get(k);
+            if (v) {
+                ++*v;
+            } else {
+                partial.insert(k, 1);
+            }
+            oraclemap[k]++;
+        }
+        merged.merge(std::move(partial), [](size_t &v, size_t &&other) { v += other; });
+        assert_eq(partial.size(), (size_t)0);
+        assert(partial.get(dis(gen)) == nullptr);
+    }
+    assert_eq(merged.size(), oraclemap.size());
+    for (auto kv : oraclemap) {
+        size_t *v = merged.get(kv.first);
+        assert(v != nullptr);
+        assert_eq(*v, kv.second);
+    }
+
+    // Keys that need their destructors to run
+    HashTbl<std::string, std::string> left;
+    HashTbl<std::string, std::string> right;
+    for (size_t i = 0; i < 1000; ++i) {
+        left.insert("key number " + std::to_string(i), "a");
+        right.insert("key number " + std::to_string(i + 500), "b");
+    }
+    left.merge(std::move(right), [](std::string &v, std::string &&other) { v += other; });
+    assert_eq(left.size(), (size_t)1500);
+    assert_eq(right.size(), (size_t)0);
+    assert_eq(*left.get("key number 0"), std::string("a"));
+    assert_eq(*left.get("key number 500"), std::string("ab"));
+    assert_eq(*left.get("key number 1499"), std::string("b"));
+}
+
+/** Owns its value, and counts how often it gets move-constructed */
+struct Boxed
+{
+    static size_t nr_moves;
+
+    std::unique_ptr<size_t> val;
+
+    explicit Boxed(size_t val)
+        : val(new size_t(val))
+    {
+    }
+
+    Boxed(Boxed &&other)
+        : val(std::move(other.val))
+    {
+        nr_moves++;
+    }
+
+    Boxed &operator=(Boxed &&other) = default;
+};
+
+size_t Boxed::nr_moves = 0;
+
+template <> struct is_trivially_relocatable<Boxed>
+{
+    static constexpr bool value = true;
+};
+
+template <typename Growth> void test_relocatable_entries_skip_moves()
+{
+    HashTbl<size_t, Boxed, LinearProbe, SplitLayout, Growth> tbl;
+    HashTbl<size_t, Boxed, LinearProbe, SplitLayout, Growth> other;
+    for (size_t k = 0; k < 1000; ++k) {
+        tbl.insert(k, Boxed(k));
+        other.insert(k + 500, Boxed(k + 500));
+    }
+    size_t nr_moves = Boxed::nr_moves;
+    tbl.rebuild(1 << 14);
+    for (size_t k = 0; k < 1000; k += 2) {
+        other.insert(tbl.extract(k));
+    }
+    tbl.merge(std::move(other), [](Boxed &v, Boxed &&other) { *v.val += *other.val; });
+    other.insert(tbl.extract(1));
+    tbl.shrink_to_fit();
+    // Growing, extracting, reinserting and merging all went through memcpy()
+    assert_eq(Boxed::nr_moves, nr_moves);
+
+    assert_eq(tbl.size(), (size_t)1499);
+    assert_eq(other.size(), (size_t)1);
+    assert_eq(*other.get(1)->val, (size_t)1);
+    for (size_t k = 0; k < 1500; ++k) {
+        if (k == 1) continue;
+        size_t expected = k < 500 ? k : k < 1000 ? (k % 2 ? 2 * k : k) : k;
+        assert_eq(*tbl.get(k)->val, expected);
+    }
+}
+
+template <typename Probe, typename SlotLayout = SplitLayout, typename Growth = CopyGrowth>
+void test_policies_against_oracle()
+{
+    HashTbl<int, int, Probe, SlotLayout, Growth> testmap;
+    default_std_unordered_map_t<int, int> oraclemap;
+    std::mt19937_64 gen(Probe::NEEDS_POW2_CTRLCHUNKS);
+    // Clustered keys, so that we actually spend some time probing
+    std::uniform_int_distribution<int> dis(0, 1 << 16);
+    for (size_t it = 0; it < (1 << 20); ++it) {
+        int k = dis(gen) & ~0x3f0;
+        switch (dis(gen) % 3) {
+        case 0:
+            testmap.insert(k, k * 2);
+            oraclemap[k] = k * 2;
+            break;
+        case 1:
+            testmap.remove(k);
+            oraclemap.erase(k);
+            break;
+        default: {
+            int *testv = testmap.get(k);
+            auto oraclev = oraclemap.find(k);
+            assert((testv == nullptr) == (oraclev == oraclemap.end()));
+            if (testv) assert_eq(*testv, oraclev->second);
+        }
+        }
+    }
+    assert_eq(testmap.size(), oraclemap.size());
+    for (auto kv : oraclemap) {
+        assert_eq(*testmap.get(kv.first), kv.second);
+    }
+}
+
+template <typename Probe, typename SlotLayout> void test_grow_in_place_keeps_entries()
+{
+    // Keys that crowd every 4th chunk, so that they overflow (but not so far
+    // that the counts saturate), some of them flipped so that the last chunk
+    // overflows around to the first, and removes in between so there are
+    // holes to fill
+    HashTbl<size_t, size_t, Probe, SlotLayout, InPlaceGrowth> tbl;
+    default_std_unordered_map_t<size_t, size_t> oraclemap;
+    std::mt19937_64 gen(17);
+    size_t nr_grows = 0;
+    for (size_t i = 0; i < (1 << 17); ++i) {
+        size_t k = (gen() % (1 << 18)) & ~0x30;
+        if (i % 8 == 0) k = ~k;
+        size_t nr_ctrlchunks = tbl.nr_ctrlchunks();
+        if (i % 5 == 0) {
+            tbl.remove(k);
+            oraclemap.erase(k);
+        } else {
+            tbl.insert(k, i);
+            oraclemap[k] = i;
+        }
+        if (tbl.nr_ctrlchunks() != nr_ctrlchunks) {
+            nr_grows++;
+            if (nr_ctrlchunks) assert_eq(tbl.nr_ctrlchunks(), nr_ctrlchunks * 2);
+        }
+    }
+    assert(nr_grows > 8);
+    assert_eq(tbl.size(), oraclemap.size());
+    for (auto kv : oraclemap) {
+        assert_eq(*tbl.get(kv.first), kv.second);
+    }
+    size_t nr_iterated = 0;
+    for (auto kv : tbl) {
+        assert_eq(oraclemap[kv.first], kv.second);
+        nr_iterated++;
+    }
+    assert_eq(nr_iterated, oraclemap.size());
+    // Removing everything has to bring every overflow count back down
+    for (auto kv : oraclemap) {
+        tbl.remove(kv.first);
+    }
+    assert_eq(tbl.size(), (size_t)0);
+    for (auto kv : oraclemap) {
+        assert_eq(tbl.probe_length(kv.first), (size_t)1);
+    }
+}
+
+void test_removes_release_overflows()
+{
+    auto tbl = HashTbl<size_t, size_t>::with_capacity(4096);
+    // 4 home chunks with 64 keys each, so they overflow into their neighbours
+    // (but not so much that the counts saturate)
+    for (size_t i = 0; i < 256; ++i) {
+        tbl.insert(i * 1024, i);
+    }
+    size_t longest_probe = 0;
+    for (size_t i = 0; i < 256; ++i) {
+        longest_probe = std::max(longest_probe, tbl.probe_length(i * 1024));
+    }
+    assert_eq(longest_probe, (size_t)(64 / CtrlChunk::NR_BYTES));
+    for (size_t i = 0; i < 256; ++i) {
+        tbl.remove(i * 1024);
+    }
+    assert_eq(tbl.size(), (size_t)0);
+    // Every count is back to 0, so every miss is settled by its home chunk
+    for (size_t i = 0; i < 256; ++i) {
+        assert_eq(tbl.probe_length(i * 1024), (size_t)1);
+        assert(tbl.get(i * 1024) == nullptr);
+    }
+}
+
+/** `DirectTbl` has to act just like the hashed table */
+template <typename Key> void test_direct_keys_against_oracle()
+{
+    DirectTbl<Key, std::string> tbl;
+    std::map<Key, std::string> oraclemap;
+    std::mt19937_64 gen(13);
+    assert(tbl.get(0) == nullptr);
+    assert(tbl.begin() == tbl.end());
+    for (size_t i = 0; i < (1 << 18); ++i) {
+        Key k = (Key)gen();
+        switch (gen() % 4) {
+        case 0:
+            tbl.insert(k, std::to_string(i));
+            oraclemap[k] = std::to_string(i);
+            break;
+        case 1:
+            tbl.remove(k);
+            oraclemap.erase(k);
+            break;
+        case 2: {
+            std::string *v = tbl.upsert(k, "x", [](std::string &v) { v += "y"; });
+            auto it = oraclemap.find(k);
+            if (it == oraclemap.end()) {
+                oraclemap[k] = "x";
+            } else {
+                it->second += "y";
+            }
+            assert_eq(*v, oraclemap[k]);
+            break;
+        }
+        case 3: {
+            std::string *v = tbl.get(k);
+            auto it = oraclemap.find(k);
+            assert((v != nullptr) == (it != oraclemap.end()));
+            if (v) assert_eq(*v, it->second);
+            break;
+        }
+        }
+    }
+    assert_eq(tbl.size(), oraclemap.size());
+
+    // Iteration goes in unsigned key order, which for signed keys puts the
+    // negative ones last
+    typedef typename std::make_unsigned<Key>::type UKey;
+    std::vector<std::pair<Key, std::string>> expected(oraclemap.begin(), oraclemap.end());
+    std::sort(expected.begin(), expected.end(),
+              [](std::pair<Key, std::string> const &a, std::pair<Key, std::string> const &b) {
+                  return (UKey)a.first < (UKey)b.first;
+              });
+    size_t i = 0;
+    for (auto kv : tbl) {
+        assert(kv.first == expected[i].first);
+        assert_eq(kv.second, expected[i].second);
+        i++;
+    }
+    assert_eq(i, expected.size());
+
+    size_t nr_odd = 0;
+    for (auto kv : oraclemap) {
+        nr_odd += kv.first % 2 != 0;
+    }
+    assert_eq(tbl.erase_if([](Key const &k, std::string &) { return k % 2 != 0; }), nr_odd);
+    assert_eq(tbl.size(), oraclemap.size() - nr_odd);
+    for (auto kv : tbl) {
+        assert(kv.first % 2 == 0);
+    }
+}
+
+void test_capacity_management()
+{
+    HashTbl<size_t, std::string> tbl;
+    tbl.reserve(10000);
+    size_t nr_ctrlchunks = tbl.nr_ctrlchunks();
+    for (size_t i = 0; i < 10000; ++i) {
+        tbl.insert(i * 7919, std::to_string(i));
+    }
+    // It grew once, up front
+    assert_eq(tbl.nr_ctrlchunks(), nr_ctrlchunks);
+    // and reserving less than we have does nothing
+    tbl.reserve(10);
+    assert_eq(tbl.nr_ctrlchunks(), nr_ctrlchunks);
+
+    for (size_t i = 100; i < 10000; ++i) {
+        tbl.remove(i * 7919);
+    }
+    tbl.shrink_to_fit();
+    assert(tbl.nr_ctrlchunks() < nr_ctrlchunks);
+    assert_eq(tbl.size(), (size_t)100);
+    for (size_t i = 0; i < 10000; ++i) {
+        std::string *v = tbl.get(i * 7919);
+        assert((v != nullptr) == (i < 100));
+        if (v) assert_eq(*v, std::to_string(i));
+    }
+
+    // Rehashing below what the entries need only goes down to that
+    tbl.rehash(1);
+    assert_eq(tbl.size(), (size_t)100);
+    assert(tbl.nr_ctrlchunks() * CtrlChunk::NR_BYTES / 4 * 3 > 100);
+    tbl.rehash(5000);
+    assert_eq(tbl.nr_ctrlchunks() * CtrlChunk::NR_BYTES, nextpow2(5000));
+    assert_eq(*tbl.get(99 * 7919), std::string("99"));
+
+    tbl.erase_if([](size_t const &, std::string &) { return true; });
+    tbl.shrink_to_fit();
+    assert_eq(tbl.nr_ctrlchunks(), (size_t)0);
+    assert(tbl.get(0) == nullptr);
+    tbl.insert(1, "x");
+    assert_eq(*tbl.get(1), std::string("x"));
+}
+
+void test_batch_ops_against_oracle()
+{
+    // One table that only ever grows (a power of 2 capacity) and one that
+    // doesn't, as they find home chunks differently
+    HashTbl<size_t, size_t> grown;
+    auto sized = HashTbl<size_t, size_t>::with_capacity(1000);
+    default_std_unordered_map_t<size_t, size_t> oraclemap;
+    std::mt19937_64 gen(13);
+    std::uniform_int_distribution<size_t> dis(0, 1 << 14);
+    for (size_t round = 0; round < 8; ++round) {
+        // Odd sizes, so that batches don't line up with `BATCH_SIZE`
+        size_t n = 1000 + round * 777;
+        std::vector<size_t> keys(n);
+        std::vector<size_t> vals(n);
+        for (size_t i = 0; i < n; ++i) {
+            keys[i] = dis(gen);
+            vals[i] = gen();
+            oraclemap[keys[i]] = vals[i];
+        }
+        grown.insert_batch(keys.data(), vals.data(), n);
+        sized.insert_batch(keys.data(), vals.data(), n);
+        assert_eq(grown.size(), oraclemap.size());
+        assert_eq(sized.size(), oraclemap.size());
+
+        for (size_t i = 0; i < n; ++i) {
+            keys[i] = dis(gen);
+        }
+        size_t nr_expected = 0;
+        for (size_t k : keys) {
+            nr_expected += oraclemap.count(k);
+        }
+        std::vector<size_t *> found(n);
+        assert_eq(grown.get_batch(keys.data(), n, found.data()), nr_expected);
+        for (size_t i = 0; i < n; ++i) {
+            auto it = oraclemap.find(keys[i]);
+            assert((found[i] != nullptr) == (it != oraclemap.end()));
+            if (found[i]) assert_eq(*found[i], it->second);
+        }
+        assert_eq(sized.get_batch(keys.data(), n, found.data()), nr_expected);
+        for (size_t i = 0; i < n; ++i) {
+            auto it = oraclemap.find(keys[i]);
+            assert((found[i] != nullptr) == (it != oraclemap.end()));
+            if (found[i]) assert_eq(*found[i], it->second);
+        }
+    }
+}
+
 int main()
 {
     using tests = test_suite<default_std_unordered_map_t, ChainTable>;
@@ -181,5 +693,35 @@ int main()
     RUNTEST(tests::test_uint64_marks_entries_contained);
     RUNTEST(tests::test_int_overrides_old_val);
     RUNTEST(tests::test_sequence_of_random_operations_against_oracle);
+    using hashtbl_tests = test_suite<default_std_unordered_map_t, hashtbl_t>;
+    RUNTEST(hashtbl_tests::test_uint64_inserts_persist);
+    RUNTEST(hashtbl_tests::test_uint64_marks_entries_contained);
+    RUNTEST(hashtbl_tests::test_int_overrides_old_val);
+    RUNTEST(hashtbl_tests::test_sequence_of_random_operations_against_oracle);
+    RUNTEST(test_removes_release_overflows);
+    RUNTEST(test_iter_after_mass_removes);
+    RUNTEST(test_erase_if_against_oracle);
+    RUNTEST(test_extract_and_reinsert_nodes);
+    RUNTEST(test_hashed_ops_across_tables);
+    RUNTEST(test_upsert_against_oracle);
+    RUNTEST(test_merge_against_oracle);
+    RUNTEST(test_batch_ops_against_oracle);
+    RUNTEST(test_capacity_management);
+    RUNTEST(test_relocatable_entries_skip_moves<CopyGrowth>);
+    RUNTEST(test_relocatable_entries_skip_moves<InPlaceGrowth>);
+    RUNTEST(test_policies_against_oracle<LinearProbe>);
+    RUNTEST(test_policies_against_oracle<TriangularProbe>);
+    RUNTEST(test_policies_against_oracle<DoubleHashProbe>);
+    RUNTEST((test_policies_against_oracle<LinearProbe, InterleavedLayout>));
+    RUNTEST((test_policies_against_oracle<TriangularProbe, InterleavedLayout>));
+    RUNTEST((test_policies_against_oracle<LinearProbe, SplitLayout, InPlaceGrowth>));
+    RUNTEST((test_policies_against_oracle<DoubleHashProbe, InterleavedLayout, InPlaceGrowth>));
+    RUNTEST((test_grow_in_place_keeps_entries<LinearProbe, SplitLayout>));
+    RUNTEST((test_grow_in_place_keeps_entries<TriangularProbe, InterleavedLayout>));
+    RUNTEST(test_direct_keys_against_oracle<unsigned char>);
+    RUNTEST(test_direct_keys_against_oracle<char>);
+    RUNTEST(test_direct_keys_against_oracle<signed char>);
+    RUNTEST(test_direct_keys_against_oracle<unsigned short>);
+    RUNTEST(test_direct_keys_against_oracle<short>);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,125 @@
+// The whole table, built with the portable SWAR ctrl chunks instead of SSE2
+#define HASHMAP_SWAR
+#include <hashmap.hpp>
+#include <hashcache.hpp>
+#include <unordered_map>
+#include <random>
+#include "test.hpp"
+
+static_assert(CtrlChunk::NR_BYTES == 8, "HASHMAP_SWAR should give 8-byte ctrl chunks");
+
+uint8_t scalar_movemask_eq(uint64_t v, char b)
+{
+    uint8_t mask = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        if ((char)(v >> (8 * i)) == b) mask |= 1 << i;
+    }
+    return mask;
+}
+
+/**
+ * Words made of only a few byte values, next to each other in every order,
+ * which is where a borrow from one byte into the next would show up.
+ */
+void swar_movemask_eq_is_exact()
+{
+    std::mt19937_64 gen(19);
+    char const bytes[] = {0, 1, (char)0x7f, (char)0x80, (char)0x81, (char)0xfe, (char)0xff};
+    size_t const nr_bytes = sizeof(bytes);
+    for (size_t i = 0; i < 200000; ++i) {
+        uint64_t v = 0;
+        for (size_t j = 0; j < 8; ++j) {
+            v |= (uint64_t)(uint8_t)bytes[gen() % nr_bytes] << (8 * j);
+        }
+        for (char needle : bytes) {
+            assert_eq((int)simd<uint64_t>::movemask_eq(v, needle),
+                      (int)scalar_movemask_eq(v, needle));
+        }
+    }
+}
+
+void swar_masks_round_trip()
+{
+    for (uint32_t mask = 0; mask < 256; ++mask) {
+        uint64_t lanes = usimd<uint64_t>::unmovemask_i8(mask);
+        for (size_t i = 0; i < 8; ++i) {
+            assert_eq((lanes >> (8 * i)) & 0xff, (mask >> i) & 1 ? 0xffu : 0u);
+        }
+        assert_eq((uint32_t)usimd<uint64_t>::movemask_i8(lanes), mask);
+        assert_eq((uint32_t)simd<uint64_t>::set_ones(0, mask), (uint32_t)lanes);
+    }
+    assert_eq((int)CtrlChunk::mask_ctz(0), 8);
+}
+
+void test_tbl_against_oracle()
+{
+    HashTbl<size_t, size_t> tbl;
+    std::unordered_map<size_t, size_t> oraclemap;
+    std::mt19937_64 gen(23);
+    std::uniform_int_distribution<size_t> dis(0, 1 << 16);
+    for (size_t i = 0; i < (1 << 19); ++i) {
+        size_t k = dis(gen);
+        switch (gen() % 4) {
+        case 0:
+            tbl.insert(k, i);
+            oraclemap[k] = i;
+            break;
+        case 1:
+            tbl.remove(k);
+            oraclemap.erase(k);
+            break;
+        case 2:
+            assert_eq(*tbl.upsert(k, 1, [](size_t &v) { v++; }), ++oraclemap[k]);
+            break;
+        case 3: {
+            size_t *v = tbl.get(k);
+            auto it = oraclemap.find(k);
+            assert((v != nullptr) == (it != oraclemap.end()));
+            if (v) assert_eq(*v, it->second);
+            break;
+        }
+        }
+    }
+    assert_eq(tbl.size(), oraclemap.size());
+    size_t nr_seen = 0;
+    for (auto kv : tbl) {
+        assert_eq(oraclemap.at(kv.first), kv.second);
+        nr_seen++;
+    }
+    assert_eq(nr_seen, oraclemap.size());
+    size_t nr_odd = 0;
+    for (auto kv : oraclemap) {
+        nr_odd += kv.second % 2;
+    }
+    assert_eq(tbl.erase_if([](size_t const &, size_t &v) { return v % 2; }), nr_odd);
+    assert_eq(tbl.size(), oraclemap.size() - nr_odd);
+}
+
+/** `HashCache`'s reference bits go by the chunk width too */
+void test_cache_second_chance()
+{
+    HashCache<size_t, size_t> cache(1 << 16);
+    size_t cap = cache.capacity();
+    for (size_t k = 0; k < cap; ++k) {
+        cache.put(k, k);
+    }
+    for (size_t k = 0; k < cap; k += 2) {
+        assert(cache.get(k) != nullptr);
+    }
+    for (size_t k = 1; k < cap; k += 2) {
+        cache.put(cap + k, k);
+    }
+    assert_eq(cache.get_stats().evictions, cap / 2);
+    for (size_t k = 0; k < cap; k += 2) {
+        assert(cache.get(k) != nullptr);
+    }
+}
+
+int main()
+{
+    RUNTEST(swar_movemask_eq_is_exact);
+    RUNTEST(swar_masks_round_trip);
+    RUNTEST(test_tbl_against_oracle);
+    RUNTEST(test_cache_second_chance);
+    return 0;
+}
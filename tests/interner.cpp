@@ -0,0 +1,67 @@
+#include <interner.hpp>
+#include <unordered_map>
+#include <string>
+#include <vector>
+#include <random>
+#include "test.hpp"
+
+void test_ids_are_dense_and_stable()
+{
+    StringInterner interner;
+    assert_eq(interner.intern("host-a"), (uint32_t)0);
+    assert_eq(interner.intern("host-b"), (uint32_t)1);
+    assert_eq(interner.intern(""), (uint32_t)2);
+    assert_eq(interner.intern(std::string("host-a")), (uint32_t)0);
+    assert_eq(interner.intern(""), (uint32_t)2);
+    assert_eq(interner.size(), (size_t)3);
+
+    assert_eq(std::string(interner.str(1)), "host-b");
+    assert_eq(interner.str(2).size(), (size_t)0);
+    assert_eq(*interner.find("host-b"), (uint32_t)1);
+    assert(interner.find("host-c") == nullptr);
+
+    // Lookups only borrow the bytes, they don't have to be NUL-terminated
+    char const buf[] = "host-axyz";
+    assert_eq(*interner.find(std::string_view(buf, 6)), (uint32_t)0);
+}
+
+void test_against_oracle()
+{
+    StringInterner interner;
+    std::unordered_map<std::string, uint32_t> oraclemap;
+    std::vector<std::string> oraclestrs;
+    std::mt19937_64 gen(17);
+    std::uniform_int_distribution<size_t> key_dis(0, 50000);
+    char const *first_data = nullptr;
+    for (size_t i = 0; i < 200000; ++i) {
+        size_t k = key_dis(gen);
+        // Lengths all over the place, including bigger than an arena chunk
+        std::string str = "metric." + std::to_string(k) + std::string(k % 101, 'x');
+        if (k == 42) str += std::string(StringInterner::CHUNK_SIZE * 2, 'y');
+        auto it = oraclemap.find(str);
+        uint32_t id = interner.intern(str);
+        if (it == oraclemap.end()) {
+            assert_eq(id, (uint32_t)oraclestrs.size());
+            oraclemap[str] = id;
+            oraclestrs.push_back(str);
+        } else {
+            assert_eq(id, it->second);
+        }
+        if (i == 1000) first_data = interner.str(0).data();
+    }
+
+    assert_eq(interner.size(), oraclestrs.size());
+    for (uint32_t id = 0; id < oraclestrs.size(); ++id) {
+        assert(interner.str(id) == std::string_view(oraclestrs[id]));
+        assert_eq(*interner.find(oraclestrs[id]), id);
+    }
+    // Strings never move once interned
+    assert(first_data == interner.str(0).data());
+}
+
+int main()
+{
+    RUNTEST(test_ids_are_dense_and_stable);
+    RUNTEST(test_against_oracle);
+    return 0;
+}
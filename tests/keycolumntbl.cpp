@@ -0,0 +1,145 @@
+#include <keycolumntbl.hpp>
+#include <unordered_map>
+#include <string>
+#include <vector>
+#include <random>
+#include "test.hpp"
+
+template <typename Key, typename Column = KeyColumn<Key>> void test_match_sets_a_bit_per_equal_key()
+{
+    alignas(64) Key keys[16];
+    for (size_t i = 0; i < 16; ++i) {
+        keys[i] = i * 3;
+    }
+    keys[5] = keys[11] = 1000;
+    for (size_t i = 0; i < 16; ++i) {
+        if (i == 5 || i == 11) continue;
+        assert_eq(Column::match(keys, i * 3), 1 << i);
+    }
+    assert_eq(Column::match(keys, 1000), (1 << 5) | (1 << 11));
+    assert_eq(Column::match(keys, 1), 0);
+    // Only the low bits of the key can match
+    assert_eq(Column::match(keys, (Key)-1), 0);
+}
+
+#ifdef __SSE2__
+void test_wider_u32_matches()
+{
+    if (simd_level_supported(SimdLevel::AVX2)) {
+        test_match_sets_a_bit_per_equal_key<uint32_t, KeyColumnAt<uint32_t, SimdLevel::AVX2>>();
+    }
+    if (simd_level_supported(SimdLevel::AVX512)) {
+        test_match_sets_a_bit_per_equal_key<uint32_t, KeyColumnAt<uint32_t, SimdLevel::AVX512>>();
+    }
+}
+
+/** `get_batch()` picks its compare from the kernels, so try each */
+template <typename Key> void test_get_batch_under_every_level()
+{
+    KeyColumnTbl<Key, size_t> tbl;
+    std::vector<Key> keys;
+    std::mt19937_64 gen(41);
+    for (size_t i = 0; i < 20000; ++i) {
+        Key key = gen();
+        tbl.insert(key, i);
+        keys.push_back(key);
+        // mostly misses, at least for `uint32_t`
+        keys.push_back(gen());
+    }
+    SimdLevel levels[] = {SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512};
+    for (SimdLevel level : levels) {
+        if (!simd_level_supported(level)) continue;
+        force_simd_level(level);
+        std::vector<size_t *> vals(keys.size());
+        tbl.get_batch(keys.data(), keys.size(), vals.data());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            assert(vals[i] == tbl.get(keys[i]));
+        }
+    }
+    force_simd_level(detect_simd_level());
+}
+#endif
+
+template <typename Key> void test_tbl_against_oracle(uint32_t max_key)
+{
+    KeyColumnTbl<Key, size_t> tbl;
+    std::unordered_map<Key, size_t> oraclemap;
+    std::mt19937_64 gen(37);
+    std::uniform_int_distribution<uint32_t> dis(0, max_key);
+    std::uniform_int_distribution<int> op_dis(0, 3);
+
+    for (size_t i = 0; i < 400000; ++i) {
+        Key key = dis(gen);
+        switch (op_dis(gen)) {
+        case 0:
+        case 1:
+            tbl.insert(key, i);
+            oraclemap[key] = i;
+            break;
+        case 2:
+            tbl.remove(key);
+            oraclemap.erase(key);
+            break;
+        case 3: {
+            size_t *val = tbl.get(key);
+            KeyColumnTbl<Key, size_t> const &const_tbl = tbl;
+            assert(const_tbl.get(key) == val);
+            auto it = oraclemap.find(key);
+            if (it == oraclemap.end()) {
+                assert(val == nullptr);
+            } else {
+                assert_eq(*val, it->second);
+            }
+            break;
+        }
+        }
+    }
+    assert_eq(tbl.size(), oraclemap.size());
+    size_t nr_seen = 0;
+    tbl.for_each([&](Key key, size_t val) {
+        assert_eq(oraclemap.at(key), val);
+        nr_seen++;
+    });
+    assert_eq(nr_seen, oraclemap.size());
+}
+
+/** Every `uint16_t` there is, which fills the table right up to where it grows */
+void test_whole_u16_key_space()
+{
+    KeyColumnTbl<uint16_t, std::string> tbl;
+    for (uint32_t key = 0; key <= 0xffff; ++key) {
+        tbl.insert(key, std::to_string(key));
+    }
+    assert_eq(tbl.size(), (size_t)0x10000);
+    for (uint32_t key = 0; key <= 0xffff; ++key) {
+        assert_eq(*tbl.get(key), std::to_string(key));
+    }
+    for (uint32_t key = 0; key <= 0xffff; key += 2) {
+        tbl.remove(key);
+    }
+    assert_eq(tbl.size(), (size_t)0x8000);
+    for (uint32_t key = 0; key <= 0xffff; ++key) {
+        std::string *val = tbl.get(key);
+        if (key % 2) {
+            assert_eq(*val, std::to_string(key));
+        } else {
+            assert(val == nullptr);
+        }
+    }
+}
+
+int main()
+{
+    RUNTEST(test_match_sets_a_bit_per_equal_key<uint32_t>);
+    RUNTEST(test_match_sets_a_bit_per_equal_key<uint16_t>);
+#ifdef __SSE2__
+    RUNTEST(test_wider_u32_matches);
+    RUNTEST(test_get_batch_under_every_level<uint32_t>);
+    RUNTEST(test_get_batch_under_every_level<uint16_t>);
+#endif
+    RUNTEST([] { test_tbl_against_oracle<uint32_t>(100000); });
+    RUNTEST([] { test_tbl_against_oracle<uint32_t>(0xffffffff); });
+    RUNTEST([] { test_tbl_against_oracle<uint16_t>(0xffff); });
+    RUNTEST(test_whole_u16_key_space);
+    return 0;
+}
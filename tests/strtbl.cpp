@@ -0,0 +1,89 @@
+#include <strtbl.hpp>
+#include <unordered_map>
+#include <string>
+#include <random>
+#include "test.hpp"
+
+void test_inline_and_arena_keys()
+{
+    StrTbl<int> tbl;
+    // Around the inline length, and keys that share a prefix or a length
+    tbl.insert("", 0);
+    tbl.insert("abcdefghijk", 11);
+    tbl.insert("abcdefghijkl", 12);
+    tbl.insert("abcdefghijklm", 13);
+    tbl.insert("abcdefghijklX", 14);
+    tbl.insert("abcdXfghijklm", 15);
+    assert_eq(tbl.size(), (size_t)6);
+    assert_eq(*tbl.get(""), 0);
+    assert_eq(*tbl.get("abcdefghijk"), 11);
+    assert_eq(*tbl.get("abcdefghijkl"), 12);
+    assert_eq(*tbl.get("abcdefghijklm"), 13);
+    assert_eq(*tbl.get("abcdefghijklX"), 14);
+    assert_eq(*tbl.get("abcdXfghijklm"), 15);
+    assert(tbl.get("abcdefghij") == nullptr);
+    assert(tbl.get("abcdefghijklmn") == nullptr);
+    assert_eq(tbl.arena_size(), (size_t)39);
+
+    tbl.insert("abcdefghijklm", 16);
+    assert_eq(*tbl.get("abcdefghijklm"), 16);
+    assert_eq(tbl.arena_size(), (size_t)39);
+
+    tbl.remove("abcdefghijklm");
+    tbl.remove("abcdefghijklX");
+    assert(tbl.get("abcdefghijklm") == nullptr);
+    // More than half the arena was dead, so it got compacted
+    assert_eq(tbl.arena_size(), (size_t)13);
+    assert_eq(*tbl.get("abcdXfghijklm"), 15);
+}
+
+void test_against_oracle()
+{
+    StrTbl<size_t> tbl;
+    std::unordered_map<std::string, size_t> oraclemap;
+    std::mt19937_64 gen(23);
+    std::uniform_int_distribution<size_t> key_dis(0, 20000);
+    std::uniform_int_distribution<int> op_dis(0, 3);
+
+    auto make_str = [](size_t k) { return std::to_string(k) + std::string(k % 130, 'k'); };
+    for (size_t i = 0; i < 300000; ++i) {
+        size_t k = key_dis(gen);
+        std::string str = make_str(k);
+        switch (op_dis(gen)) {
+        case 0:
+        case 1:
+            tbl.insert(str, i);
+            oraclemap[str] = i;
+            break;
+        case 2:
+            tbl.remove(str);
+            oraclemap.erase(str);
+            break;
+        case 3: {
+            size_t *val = tbl.get(str);
+            auto it = oraclemap.find(str);
+            if (it == oraclemap.end()) {
+                assert(val == nullptr);
+            } else {
+                assert_eq(*val, it->second);
+            }
+            break;
+        }
+        }
+    }
+
+    assert_eq(tbl.size(), oraclemap.size());
+    size_t nr_seen = 0;
+    tbl.for_each([&](std::string_view key, size_t val) {
+        assert_eq(oraclemap[std::string(key)], val);
+        nr_seen++;
+    });
+    assert_eq(nr_seen, oraclemap.size());
+}
+
+int main()
+{
+    RUNTEST(test_inline_and_arena_keys);
+    RUNTEST(test_against_oracle);
+    return 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <iostream>
+#include <cassert>
+
+/** Run the test `fn` (anything callable), reporting when it starts and ends */
+#define RUNTEST(fn)                                                    \
+    ({                                                                 \
+        std::cout << "\033[1;34m  start:\033[0m " << #fn << std::endl; \
+        auto f = fn;                                                   \
+        f();                                                           \
+        std::cout << "\033[1;32msuccess:\033[0m " << #fn << std::endl; \
+        0;                                                             \
+    })
+
+/** `assert(a == b)`, printing both sides first if they differ */
+#define assert_eq(aexpr, bexpr)                         \
+    ({                                                  \
+        auto a = aexpr;                                 \
+        auto b = bexpr;                                 \
+        if (a != b) {                                   \
+            std::cout << a << " != " << b << std::endl; \
+            assert(a == b);                             \
+        }                                               \
+    })